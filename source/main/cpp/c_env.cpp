@@ -11,7 +11,7 @@
 #    include "kernel32.h"
 #    include "iphlpapi.h"
 
-#elif defined TARGET_MAC
+#elif defined TARGET_MAC || defined TARGET_LINUX
 
 #    include <stdlib.h>
 #    include <sys/types.h>
@@ -21,12 +21,15 @@
 #    include <dirent.h>
 #    include <unistd.h>
 #    include <errno.h>
+#    include <string.h>
 
 #endif
 
 #include "cbase/c_context.h"
 #include "cenv/c_env.h"
+#include "cenv/c_env_utf.h"
 #include "cenv/private/c_assert.h"
+#include "cenv/private/c_env_hooks.h"
 
 namespace ncore
 {
@@ -41,6 +44,36 @@ namespace ncore
 
 #if defined(TARGET_OS_WINDOWS)
 
+        // convert a utf-8 string to a zero terminated wide string, the stack buffer is used when it fits
+        static wchar_t* env_widen(char const* str, wchar_t* stack, uint_t stackn)
+        {
+            // no more units than bytes, a string that fits is converted and validated in one pass
+            uint_t const size = strlen(str);
+            if (size < stackn)
+            {
+                uint_t const n = env_utf8_to_utf16(str, size, (u16*)stack);
+                check_return_val(n != env_utf_invalid, null);
+                stack[n] = L'\0';
+                return stack;
+            }
+
+            uint_t const n = env_utf8_to_utf16_len(str, size);
+            check_return_val(n != env_utf_invalid, null);
+
+            wchar_t* str_w = n < stackn ? stack : (wchar_t*)malloc(sizeof(wchar_t) * (n + 1));
+            check_return_val(str_w, null);
+
+            env_utf8_to_utf16(str, size, (u16*)str_w);
+            str_w[n] = L'\0';
+            return str_w;
+        }
+
+        static void env_widen_exit(wchar_t* str_w, wchar_t* stack)
+        {
+            if (str_w && str_w != stack)
+                free(str_w);
+        }
+
         static char* env_get_impl(char const* name, uint_t* psize)
         {
             // check
@@ -48,23 +81,19 @@ namespace ncore
 
             // done
             bool     ok      = false;
-            uint_t   size    = 0;
-            uint_t   maxn    = 256;
             char*    value   = null;
-            wchar_t* value_w = null;
+            wchar_t  name_s[128];
+            wchar_t  value_s[256];
+            wchar_t* name_w  = null;
+            wchar_t* value_w = value_s;
             do
             {
-                // make value_w
-                value_w = (wchar_t*)malloc0(sizeof(wchar_t) * maxn);
-                assert_and_check_break(value_w);
-
                 // make name
-                wchar_t name_w[512];
-                uint_t  name_n = atow(name_w, name, arrayn(name_w));
-                assert_and_check_break(name_n != -1);
+                name_w = env_widen(name, name_s, arrayn(name_s));
+                check_break(name_w);
 
-                // get it
-                size = (uint_t)kernel32()->GetEnvironmentVariableW(name_w, value_w, (DWORD)maxn);
+                // get it, most values fit in the stack buffer
+                uint_t size = (uint_t)kernel32()->GetEnvironmentVariableW(name_w, value_w, (DWORD)arrayn(value_s));
                 if (!size)
                 {
                     // error?
@@ -76,29 +105,31 @@ namespace ncore
 
                     break;
                 }
-                else if (size > maxn)
+                else if (size >= arrayn(value_s))
                 {
-                    // grow space
-                    value_w = (wchar_t*)ralloc(value_w, sizeof(wchar_t) * (size + 1));
-                    assert_and_check_break(value_w);
-
-                    // get it
-                    size = (uint_t)kernel32()->GetEnvironmentVariableW(name_w, value_w, (DWORD)size + 1);
-                    assert_and_check_break(size);
+                    // size is the exact space that is needed, including the terminator
+                    uint_t const need = size;
+                    value_w           = (wchar_t*)malloc(sizeof(wchar_t) * need);
+                    check_break(value_w);
+
+                    // get it, the variable may have grown in between
+                    size = (uint_t)kernel32()->GetEnvironmentVariableW(name_w, value_w, (DWORD)need);
+                    check_break(size && size < need);
                 }
 
-                // make value
-                maxn  = (size << 2) + 1;
-                value = (char*)malloc0(sizeof(char) * (maxn + 1));
-                assert_and_check_break(value);
+                // make value, with the exact size
+                uint_t const maxn = env_utf16_to_utf8_len((u16 const*)value_w, size);
+                check_break(maxn != env_utf_invalid);
+                value = (char*)malloc(sizeof(char) * (maxn + 1));
+                check_break(value);
 
                 // save value
-                if ((size = wtoa(value, value_w, maxn)) == -1)
-                    break;
+                env_utf16_to_utf8((u16 const*)value_w, size, value);
+                value[maxn] = '\0';
 
                 // save size
                 if (psize)
-                    *psize = size;
+                    *psize = maxn;
 
                 // ok
                 ok = true;
@@ -114,10 +145,9 @@ namespace ncore
                 value = null;
             }
 
-            // exit value_w
-            if (value_w)
-                free(value_w);
-            value_w = null;
+            // exit value_w and name_w
+            env_widen_exit(value_w, value_s);
+            env_widen_exit(name_w, name_s);
 
             // ok?
             return value;
@@ -130,26 +160,22 @@ namespace ncore
 
             // done
             bool     ok      = false;
+            wchar_t  name_s[128];
+            wchar_t  value_s[256];
+            wchar_t* name_w  = null;
             wchar_t* value_w = null;
-            uint_t   value_n = 0;
             do
             {
                 // make name
-                wchar_t name_w[512];
-                uint_t  name_n = atow(name_w, name, arrayn(name_w));
-                assert_and_check_break(name_n != -1);
+                name_w = env_widen(name, name_s, arrayn(name_s));
+                check_break(name_w);
 
                 // exists value?
                 if (value)
                 {
                     // make value
-                    value_n = strlen(value);
-                    value_w = (wchar_t*)malloc0(sizeof(wchar_t) * (value_n + 1));
-                    assert_and_check_break(value_w);
-
-                    // init value
-                    if (atow(value_w, value, value_n + 1) == -1)
-                        break;
+                    value_w = env_widen(value, value_s, arrayn(value_s));
+                    check_break(value_w);
 
                     // set it
                     if (!kernel32()->SetEnvironmentVariableW(name_w, value_w))
@@ -169,9 +195,8 @@ namespace ncore
             } while (0);
 
             // exit data
-            if (value_w)
-                free(value_w);
-            value_w = null;
+            env_widen_exit(value_w, value_s);
+            env_widen_exit(name_w, name_s);
 
             // ok?
             return ok;
@@ -231,7 +256,7 @@ namespace ncore
             return vector_size(env);
         }
 
-        bool env_save(env_t* env, char const* name)
+        static bool env_save_impl(env_t* env, char const* name)
         {
             // check
             assert_and_check_return_val(env && name, false);
@@ -306,7 +331,7 @@ namespace ncore
             return size;
         }
 
-        bool env_remove(char const* name)
+        static bool env_remove_impl(char const* name)
         {
             // check
             assert_and_check_return_val(name, false);
@@ -315,7 +340,17 @@ namespace ncore
             return env_set_impl(name, null);
         }
 
-#elif defined(TARGET_MAC)
+        char const* env_native_acquire(char const* name, uint_t* psize) { return env_get_impl(name, psize); }
+
+        void env_native_release(char const* value)
+        {
+            if (value)
+                free((void*)value);
+        }
+
+        bool env_native_set(char const* name, char const* value) { return env_set_impl(name, value); }
+
+#elif defined(TARGET_MAC) || defined(TARGET_LINUX)
 
         uint_t env_load(env_t* env, char const* name)
         {
@@ -366,7 +401,7 @@ namespace ncore
             return vector_size(env);
         }
 
-        bool env_save(env_t* env, char const* name)
+        static bool env_save_impl(env_t* env, char const* name)
         {
             // check
             assert_and_check_return_val(env && name, false);
@@ -426,7 +461,7 @@ namespace ncore
             assert_and_check_return_val(size < maxn, 0);
 
             // copy it
-            strlcpy(value, data, maxn);
+            memcpy(value, data, size);
             value[size] = '\0';
 
             // only get the first one if exists multiple values
@@ -444,7 +479,7 @@ namespace ncore
             return size;
         }
 
-        bool env_remove(char const* name)
+        static bool env_remove_impl(char const* name)
         {
             // check
             assert_and_check_return_val(name, false);
@@ -453,7 +488,142 @@ namespace ncore
             return !unsetenv(name);
         }
 
+        char const* env_native_acquire(char const* name, uint_t* psize)
+        {
+            char const* value = getenv(name);
+            if (value && psize)
+                *psize = strlen(value);
+            return value;
+        }
+
+        void env_native_release(char const*) {}
+
+        bool env_native_set(char const* name, char const* value) { return value ? !setenv(name, value, 1) : !unsetenv(name); }
+
 #endif
 
+        void env_hook_before(char const* name)
+        {
+            env_guard_journal(name);
+            env_watch_before(name);
+            env_fingerprint_before(name);
+        }
+
+        void env_hook_after(char const* name)
+        {
+            // the subscribers see the updated fingerprints
+            env_fingerprint_after(name);
+            env_watch_after(name);
+        }
+
+        bool env_save(env_t* env, char const* name)
+        {
+            // check
+            assert_and_check_return_val(env && name, false);
+
+            // save it
+            env_hook_before(name);
+            bool const ok = env_save_impl(env, name);
+            env_hook_after(name);
+
+            // ok?
+            return ok;
+        }
+
+        bool env_remove(char const* name)
+        {
+            // check
+            assert_and_check_return_val(name, false);
+
+            // remove it
+            env_hook_before(name);
+            bool const ok = env_remove_impl(name);
+            env_hook_after(name);
+
+            // ok?
+            return ok;
+        }
+
+        uint_t env_get(char const* name, char* values, uint_t maxn)
+        {
+            // check
+            assert_and_check_return_val(name && values && maxn, 0);
+
+            // get it
+            uint_t      size = 0;
+            char const* data = env_native_acquire(name, &size);
+            check_return_val(data, 0);
+
+            // the space is not enough
+            if (size >= maxn)
+                size = 0;
+            else
+                memcpy(values, data, size + 1);
+
+            // exit data
+            env_native_release(data);
+
+            // ok?
+            return size;
+        }
+
+        bool env_set(char const* name, char const* values)
+        {
+            // check
+            assert_and_check_return_val(name, false);
+
+            // set it, no values removes it
+            env_hook_before(name);
+            bool const ok = env_native_set(name, values);
+            env_hook_after(name);
+
+            // ok?
+            return ok;
+        }
+
+        bool env_add(char const* name, char const* values, bool to_head)
+        {
+            // check
+            assert_and_check_return_val(name && values, false);
+
+            // get the current values
+            uint_t      size = 0;
+            char const* data = env_native_acquire(name, &size);
+            if (!data || !size)
+            {
+                env_native_release(data);
+                return env_set(name, values);
+            }
+
+            // join them
+            bool         ok    = false;
+            uint_t const count = strlen(values);
+            char*        joint = (char*)malloc(size + count + 2);
+            if (joint)
+            {
+                char const* head  = to_head ? values : data;
+                uint_t      headn = to_head ? count : size;
+                char const* tail  = to_head ? data : values;
+                uint_t      tailn = to_head ? size : count;
+                memcpy(joint, head, headn);
+                joint[headn] = TM_ENVIRONMENT_SEP;
+                memcpy(joint + headn + 1, tail, tailn);
+                joint[headn + 1 + tailn] = '\0';
+            }
+
+            // exit data
+            env_native_release(data);
+
+            // save it
+            if (joint)
+            {
+                ok = env_set(name, joint);
+                free(joint);
+            }
+
+            // ok?
+            return ok;
+        }
+
     } // namespace nenv
 } // namespace ncore
@@ -0,0 +1,213 @@
+#include "ccore/c_target.h"
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+#    include <errno.h>
+#    include <limits.h>
+#    include <string.h>
+#    include <sys/uio.h>
+#    include <unistd.h>
+extern char** environ;
+
+#    include "cenv/c_env_export.h"
+#    include "cenv/private/c_assert.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+#    if defined(IOV_MAX) && IOV_MAX < 1024
+#        define CENV_EXPORT_IOV IOV_MAX
+#    else
+#        define CENV_EXPORT_IOV 1024
+#    endif
+
+        // gathers iovecs and writes them when full or at the end
+        struct env_writer_t
+        {
+            int          m_fd;
+            int          m_count;
+            bool         m_ok;
+            struct iovec m_iov[CENV_EXPORT_IOV];
+        };
+
+        static void env_writer_flush(env_writer_t* w)
+        {
+            struct iovec* iov   = w->m_iov;
+            int           count = w->m_count;
+            while (w->m_ok && count > 0)
+            {
+                ssize_t n = writev(w->m_fd, iov, count);
+                if (n < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+                    w->m_ok = false;
+                    break;
+                }
+
+                // skip what was written, a partial write leaves us in the middle of an iovec
+                while (count > 0 && (size_t)n >= iov->iov_len)
+                {
+                    n -= (ssize_t)iov->iov_len;
+                    iov++;
+                    count--;
+                }
+                if (count > 0)
+                {
+                    iov->iov_base = (char*)iov->iov_base + n;
+                    iov->iov_len -= (size_t)n;
+                }
+            }
+            w->m_count = 0;
+        }
+
+        static inline void env_writer_add(env_writer_t* w, char const* str, uint_t len)
+        {
+            if (len == 0)
+                return;
+            if (w->m_count == CENV_EXPORT_IOV)
+                env_writer_flush(w);
+            w->m_iov[w->m_count].iov_base = (void*)str;
+            w->m_iov[w->m_count].iov_len  = len;
+            w->m_count++;
+        }
+
+        static inline void env_writer_add(env_writer_t* w, char const* str) { env_writer_add(w, str, strlen(str)); }
+
+        static bool env_is_identifier(char const* name, uint_t len)
+        {
+            for (uint_t i = 0; i < len; ++i)
+            {
+                char const c = name[i];
+                if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (i > 0 && c >= '0' && c <= '9')))
+                    return false;
+            }
+            return len > 0;
+        }
+
+        static char const* env_dotenv_escape(char c)
+        {
+            switch (c)
+            {
+                case '\\': return "\\\\";
+                case '"': return "\\\"";
+                case '$': return "\\$";
+                case '`': return "\\`";
+                case '\n': return "\\n";
+                case '\r': return "\\r";
+            }
+            return null;
+        }
+
+        // the value split into runs that are written as they are and the escapes in between
+        static void env_writer_add_dotenv(env_writer_t* w, char const* value, uint_t len)
+        {
+            uint_t run = 0;
+            for (uint_t i = 0; i < len; ++i)
+            {
+                char const* escape = env_dotenv_escape(value[i]);
+                if (!escape)
+                    continue;
+                env_writer_add(w, value + run, i - run);
+                env_writer_add(w, escape);
+                run = i + 1;
+            }
+            env_writer_add(w, value + run, len - run);
+        }
+
+        static void env_writer_add_shell(env_writer_t* w, char const* value, uint_t len)
+        {
+            // a single quote ends the quoted string, adds an escaped quote and starts a new one
+            uint_t run = 0;
+            for (uint_t i = 0; i < len; ++i)
+            {
+                if (value[i] != '\'')
+                    continue;
+                env_writer_add(w, value + run, i - run);
+                env_writer_add(w, "'\\''");
+                run = i + 1;
+            }
+            env_writer_add(w, value + run, len - run);
+        }
+
+        static void env_writer_add_var(env_writer_t* w, env_export_format_t format, char const* name, uint_t name_len, char const* value, uint_t value_len)
+        {
+            switch (format)
+            {
+                case env_export_block:
+                    // the terminator of the value is part of the output
+                    env_writer_add(w, name, name_len);
+                    env_writer_add(w, "=", 1);
+                    env_writer_add(w, value, value_len + 1);
+                    break;
+                case env_export_dotenv:
+                    env_writer_add(w, name, name_len);
+                    env_writer_add(w, "=\"", 2);
+                    env_writer_add_dotenv(w, value, value_len);
+                    env_writer_add(w, "\"\n", 2);
+                    break;
+                case env_export_shell:
+                    if (!env_is_identifier(name, name_len))
+                        break;
+                    env_writer_add(w, "export ", 7);
+                    env_writer_add(w, name, name_len);
+                    env_writer_add(w, "='", 2);
+                    env_writer_add_shell(w, value, value_len);
+                    env_writer_add(w, "'\n", 2);
+                    break;
+            }
+        }
+
+        bool env_export_live(int fd, env_export_format_t format)
+        {
+            // check
+            assert_and_check_return_val(fd >= 0, false);
+
+            env_writer_t w;
+            w.m_fd    = fd;
+            w.m_count = 0;
+            w.m_ok    = true;
+            for (char** p = environ; p && *p; ++p)
+            {
+                char const* var = *p;
+                char const* eq  = strchr(var, '=');
+                if (!eq || eq == var)
+                    continue;
+
+                // a live entry is already NAME=VALUE\0
+                uint_t const len = strlen(var);
+                if (format == env_export_block)
+                    env_writer_add(&w, var, len + 1);
+                else
+                    env_writer_add_var(&w, format, var, (uint_t)(eq - var), eq + 1, len - (uint_t)(eq - var) - 1);
+            }
+            env_writer_flush(&w);
+            return w.m_ok;
+        }
+
+        bool env_export_snapshot(int fd, env_snapshot_t const* snap, env_export_format_t format)
+        {
+            // check
+            assert_and_check_return_val(fd >= 0 && snap, false);
+
+            env_writer_t w;
+            w.m_fd    = fd;
+            w.m_count = 0;
+            w.m_ok    = true;
+
+            env_view_t   name, value;
+            uint_t const count = env_snapshot_size(snap);
+            for (uint_t i = 0; i < count; ++i)
+            {
+                env_snapshot_at(snap, i, &name, &value);
+                env_writer_add_var(&w, format, name.m_str, name.m_len, value.m_str, value.m_len);
+            }
+            env_writer_flush(&w);
+            return w.m_ok;
+        }
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif
@@ -0,0 +1,335 @@
+#include "ccore/c_target.h"
+
+#include <string.h>
+
+#include "cbase/c_context.h"
+#include "cenv/c_env_fingerprint.h"
+#include "cenv/c_env_snapshot.h"
+#include "cenv/private/c_assert.h"
+#include "cenv/private/c_env_hooks.h"
+#include "cenv/private/c_env_snapshot_layout.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#    include <intrin.h>
+#endif
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // a tracked name, names are copied into one buffer
+        struct env_tracked_t
+        {
+            u64         m_hash;
+            char const* m_name;
+            u32         m_len;
+        };
+
+        struct env_tracker_t
+        {
+            env_tracker_t*    m_next;
+            env_fingerprint_t m_fp;
+            env_tracked_t*    m_names; // null when the whole environment is tracked
+            u32               m_count;
+            u32               m_slots; // open addressing over m_names, power of two
+            u32*              m_index; // name index + 1, 0 is empty
+        };
+
+        static env_tracker_t* s_trackers = null;
+
+        static const u64 c_fp_seed0 = 0xA0761D6478BD642Full;
+        static const u64 c_fp_seed1 = 0xE7037ED1A0B428DBull;
+        static const u64 c_fp_seed2 = 0x8EBC6AF09C88C6E3ull;
+        static const u64 c_fp_seed3 = 0x589965CC75374CC3ull;
+
+        static inline void env_fp_mul(u64 a, u64 b, u64* lo, u64* hi)
+        {
+#if defined(__SIZEOF_INT128__)
+            __uint128_t const r = (__uint128_t)a * b;
+            *lo                 = (u64)r;
+            *hi                 = (u64)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            *lo = _umul128(a, b, hi);
+#else
+            u64 const ha = a >> 32, la = (u32)a, hb = b >> 32, lb = (u32)b;
+            u64 const ll = la * lb, lh = la * hb, hl = ha * lb, hh = ha * hb;
+            u64 const mid = (ll >> 32) + (u32)lh + (u32)hl;
+            *lo           = (mid << 32) | (u32)ll;
+            *hi           = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+        }
+
+        static inline u64 env_fp_mix(u64 a, u64 b)
+        {
+            u64 lo, hi;
+            env_fp_mul(a, b, &lo, &hi);
+            return lo ^ hi;
+        }
+
+        // names are case-insensitive on windows
+        static inline u64 env_fp_load(u8 const* p, uint_t len, bool fold)
+        {
+            u64 const w = env_load_word(p, len);
+#if defined(TARGET_OS_WINDOWS)
+            return fold ? env_fold_word(w) : w;
+#else
+            (void)fold;
+            return w;
+#endif
+        }
+
+        // absorb 16 bytes per multiply, the tail is zero padded
+        static u64 env_fp_absorb(char const* str, uint_t len, u64 seed, bool fold)
+        {
+            u8 const* p = (u8 const*)str;
+            seed ^= (u64)len * c_fp_seed3;
+            while (len > 16)
+            {
+                seed = env_fp_mix(env_fp_load(p, 8, fold) ^ c_fp_seed1, env_fp_load(p + 8, 8, fold) ^ seed);
+                p += 16;
+                len -= 16;
+            }
+            u64 const a = env_fp_load(p, len, fold);
+            u64 const b = len > 8 ? env_fp_load(p + 8, len - 8, fold) : 0;
+            return env_fp_mix(a ^ c_fp_seed1, b ^ seed);
+        }
+
+        static inline u64 env_fp_name_hash(char const* name, uint_t len) { return env_fp_absorb(name, len, c_fp_seed0, true); }
+
+        static inline bool env_fp_name_equal(char const* a, char const* b, uint_t len)
+        {
+#if defined(TARGET_OS_WINDOWS)
+            return env_name_equal_folded(a, b, len);
+#else
+            return memcmp(a, b, len) == 0;
+#endif
+        }
+
+        // the contribution of one variable
+        static inline void env_fp_var(u64 name_hash, char const* value, uint_t len, env_fingerprint_t* fp)
+        {
+            u64 const h = env_fp_absorb(value, len, name_hash, false);
+            fp->m_lo    = env_fp_mix(h ^ c_fp_seed2, name_hash ^ c_fp_seed0);
+            fp->m_hi    = env_fp_mix(fp->m_lo ^ c_fp_seed3, h ^ c_fp_seed1);
+        }
+
+        static inline void env_fp_add(env_fingerprint_t* fp, env_fingerprint_t const& v)
+        {
+            fp->m_lo += v.m_lo;
+            fp->m_hi += v.m_hi;
+        }
+
+        static inline void env_fp_sub(env_fingerprint_t* fp, env_fingerprint_t const& v)
+        {
+            fp->m_lo -= v.m_lo;
+            fp->m_hi -= v.m_hi;
+        }
+
+        // add the current value of a variable, returns false if it does not exist
+        static bool env_fp_add_live(env_fingerprint_t* fp, u64 name_hash, char const* name)
+        {
+            uint_t      size  = 0;
+            char const* value = env_native_acquire(name, &size);
+            if (!value)
+                return false;
+            env_fingerprint_t v;
+            env_fp_var(name_hash, value, size, &v);
+            env_native_release(value);
+            env_fp_add(fp, v);
+            return true;
+        }
+
+        static bool env_fp_compute_all(env_fingerprint_t* fp)
+        {
+            env_snapshot_t* snap = env_snapshot_create(env_snapshot_default);
+            check_return_val(snap, false);
+
+            env_view_t        name, value;
+            env_fingerprint_t v;
+            uint_t const      count = env_snapshot_size(snap);
+            for (uint_t i = 0; i < count; ++i)
+            {
+                env_snapshot_at(snap, i, &name, &value);
+                env_fp_var(env_fp_name_hash(name.m_str, name.m_len), value.m_str, value.m_len, &v);
+                env_fp_add(fp, v);
+            }
+            env_snapshot_destroy(snap);
+            return true;
+        }
+
+        bool env_fingerprint(char const* const* names, uint_t count, env_fingerprint_t* fp)
+        {
+            // check
+            assert_and_check_return_val(fp && (names || count == 0), false);
+
+            fp->m_lo = 0;
+            fp->m_hi = 0;
+            if (!names)
+                return env_fp_compute_all(fp);
+
+            for (uint_t i = 0; i < count; ++i)
+            {
+                // a name that is listed twice counts once, like in a tracker
+                uint_t const len  = strlen(names[i]);
+                bool         seen = false;
+                for (uint_t j = 0; j < i && !seen; ++j)
+                    seen = strlen(names[j]) == len && env_fp_name_equal(names[j], names[i], len);
+                if (!seen)
+                    env_fp_add_live(fp, env_fp_name_hash(names[i], len), names[i]);
+            }
+            return true;
+        }
+
+        static env_tracked_t const* env_tracker_find(env_tracker_t const* tracker, u64 hash, char const* name, uint_t len)
+        {
+            u32 const mask = tracker->m_slots - 1;
+            for (u32 slot = (u32)hash & mask;; slot = (slot + 1) & mask)
+            {
+                u32 const i = tracker->m_index[slot];
+                if (i == 0)
+                    return null;
+                env_tracked_t const& t = tracker->m_names[i - 1];
+                if (t.m_hash == hash && t.m_len == len && env_fp_name_equal(t.m_name, name, len))
+                    return &t;
+            }
+        }
+
+        env_tracker_t* env_tracker_create(char const* const* names, uint_t count)
+        {
+            // check
+            assert_and_check_return_val(names || count == 0, null);
+
+            // one allocation, the tracker, the names, the index and the name strings
+            u32 slots = 8;
+            while (slots < count * 2)
+                slots <<= 1;
+            uint_t bytes = sizeof(env_tracker_t);
+            if (names)
+            {
+                bytes += count * sizeof(env_tracked_t) + slots * sizeof(u32);
+                for (uint_t i = 0; i < count; ++i)
+                    bytes += strlen(names[i]) + 1;
+            }
+
+            env_tracker_t* tracker = (env_tracker_t*)context_t::system_alloc()->allocate((u32)bytes);
+            check_return_val(tracker, null);
+            tracker->m_names = null;
+            tracker->m_count = 0;
+            tracker->m_slots = 0;
+            tracker->m_index = null;
+
+            if (names)
+            {
+                tracker->m_names = (env_tracked_t*)(tracker + 1);
+                tracker->m_index = (u32*)(tracker->m_names + count);
+                tracker->m_slots = slots;
+                memset(tracker->m_index, 0, slots * sizeof(u32));
+
+                char* str = (char*)(tracker->m_index + slots);
+                for (uint_t i = 0; i < count; ++i)
+                {
+                    uint_t const len  = strlen(names[i]);
+                    u64 const    hash = env_fp_name_hash(names[i], len);
+
+                    // a name that is listed twice is tracked once
+                    if (tracker->m_count && env_tracker_find(tracker, hash, names[i], len))
+                        continue;
+
+                    memcpy(str, names[i], len + 1);
+                    env_tracked_t& t = tracker->m_names[tracker->m_count++];
+                    t.m_hash         = hash;
+                    t.m_name         = str;
+                    t.m_len          = (u32)len;
+                    str += len + 1;
+
+                    u32 slot = (u32)hash & (slots - 1);
+                    while (tracker->m_index[slot] != 0)
+                        slot = (slot + 1) & (slots - 1);
+                    tracker->m_index[slot] = tracker->m_count;
+                }
+            }
+
+            tracker->m_next = s_trackers;
+            s_trackers      = tracker;
+            env_tracker_reset(tracker);
+            return tracker;
+        }
+
+        void env_tracker_destroy(env_tracker_t* tracker)
+        {
+            if (!tracker)
+                return;
+            for (env_tracker_t** link = &s_trackers; *link; link = &(*link)->m_next)
+            {
+                if (*link == tracker)
+                {
+                    *link = tracker->m_next;
+                    break;
+                }
+            }
+            context_t::system_alloc()->deallocate(tracker);
+        }
+
+        env_fingerprint_t env_tracker_fingerprint(env_tracker_t const* tracker)
+        {
+            ASSERT(tracker);
+            return tracker->m_fp;
+        }
+
+        bool env_tracker_reset(env_tracker_t* tracker)
+        {
+            // check
+            assert_and_check_return_val(tracker, false);
+
+            tracker->m_fp.m_lo = 0;
+            tracker->m_fp.m_hi = 0;
+            if (!tracker->m_names)
+                return env_fp_compute_all(&tracker->m_fp);
+
+            for (u32 i = 0; i < tracker->m_count; ++i)
+                env_fp_add_live(&tracker->m_fp, tracker->m_names[i].m_hash, tracker->m_names[i].m_name);
+            return true;
+        }
+
+        // apply the contribution of the current value of a variable to every tracker that covers it
+        static void env_fp_apply(char const* name, bool add)
+        {
+            // nobody is tracking, or a name that is not a variable
+            if (!s_trackers || !name || name[0] == '=' || name[0] == '\0')
+                return;
+
+            uint_t const len  = strlen(name);
+            u64 const    hash = env_fp_name_hash(name, len);
+
+            // the variable is only looked up when a tracker covers it
+            env_fingerprint_t v     = {0, 0};
+            s32               state = 0; // 0 not looked up, 1 exists, 2 does not exist
+            for (env_tracker_t* t = s_trackers; t; t = t->m_next)
+            {
+                if (t->m_names && !env_tracker_find(t, hash, name, len))
+                    continue;
+
+                if (state == 0)
+                {
+                    uint_t      size  = 0;
+                    char const* value = env_native_acquire(name, &size);
+                    state             = value ? 1 : 2;
+                    if (value)
+                        env_fp_var(hash, value, size, &v);
+                    env_native_release(value);
+                }
+                if (state == 2)
+                    break;
+
+                if (add)
+                    env_fp_add(&t->m_fp, v);
+                else
+                    env_fp_sub(&t->m_fp, v);
+            }
+        }
+
+        void env_fingerprint_before(char const* name) { env_fp_apply(name, false); }
+        void env_fingerprint_after(char const* name) { env_fp_apply(name, true); }
+
+    } // namespace nenv
+} // namespace ncore
@@ -0,0 +1,229 @@
+#include "ccore/c_target.h"
+
+#include <string.h>
+
+#include "cbase/c_context.h"
+#include "cenv/c_env_guard.h"
+#include "cenv/c_env_watch.h"
+#include "cenv/private/c_assert.h"
+#include "cenv/private/c_env_hooks.h"
+#include "cenv/private/c_env_snapshot_layout.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // the old state of one variable, name and value share one allocation
+        struct env_record_t
+        {
+            char*       m_name;
+            char const* m_value; // null when the variable did not exist
+            u32         m_name_len;
+            u32         m_hash;
+        };
+
+        struct env_guard_t
+        {
+            env_guard_t*  m_parent;
+            env_record_t* m_records;
+            u32*          m_index; // record index + 1, 0 is empty
+            u32           m_count;
+            u32           m_capacity;
+            u32           m_slots;
+        };
+
+        static env_guard_t* s_guard = null;
+
+        env_guard_t* env_guard_begin(void)
+        {
+            env_guard_t* guard = (env_guard_t*)context_t::system_alloc()->allocate(sizeof(env_guard_t));
+            assert_and_check_return_val(guard, null);
+
+            // the journal is only allocated when something is changed
+            guard->m_parent   = s_guard;
+            guard->m_records  = null;
+            guard->m_index    = null;
+            guard->m_count    = 0;
+            guard->m_capacity = 0;
+            guard->m_slots    = 0;
+            s_guard           = guard;
+            return guard;
+        }
+
+        static env_record_t const* env_guard_find(env_guard_t const* guard, char const* name, u32 len, u32 hash)
+        {
+            if (guard->m_slots == 0)
+                return null;
+
+            u32 const mask = guard->m_slots - 1;
+            for (u32 slot = hash & mask;; slot = (slot + 1) & mask)
+            {
+                u32 const i = guard->m_index[slot];
+                if (i == 0)
+                    return null;
+                env_record_t const& r = guard->m_records[i - 1];
+                if (r.m_hash == hash && r.m_name_len == len && env_name_equal_native(r.m_name, name, len))
+                    return &r;
+            }
+        }
+
+        static bool env_guard_grow(env_guard_t* guard)
+        {
+            alloc_t*  allocator = context_t::system_alloc();
+            u32 const capacity  = guard->m_capacity ? guard->m_capacity * 2 : 16;
+            u32 const slots     = capacity * 2;
+
+            env_record_t* records = (env_record_t*)allocator->allocate(capacity * sizeof(env_record_t));
+            u32*          index   = (u32*)allocator->allocate(slots * sizeof(u32));
+            if (!records || !index)
+            {
+                if (records)
+                    allocator->deallocate(records);
+                if (index)
+                    allocator->deallocate(index);
+                return false;
+            }
+
+            if (guard->m_count)
+                memcpy(records, guard->m_records, guard->m_count * sizeof(env_record_t));
+
+            // rehash
+            memset(index, 0, slots * sizeof(u32));
+            for (u32 i = 0; i < guard->m_count; ++i)
+            {
+                u32 slot = records[i].m_hash & (slots - 1);
+                while (index[slot] != 0)
+                    slot = (slot + 1) & (slots - 1);
+                index[slot] = i + 1;
+            }
+
+            if (guard->m_records)
+                allocator->deallocate(guard->m_records);
+            if (guard->m_index)
+                allocator->deallocate(guard->m_index);
+            guard->m_records  = records;
+            guard->m_index    = index;
+            guard->m_capacity = capacity;
+            guard->m_slots    = slots;
+            return true;
+        }
+
+        void env_guard_journal(char const* name)
+        {
+            env_guard_t* guard = s_guard;
+            if (!guard || !name)
+                return;
+
+            // only the first change of a variable is journaled, "Path" and "PATH" are one variable on windows
+            u32 const len  = (u32)strlen(name);
+            u32 const hash = env_hash_name_native(name, len);
+            if (env_guard_find(guard, name, len, hash))
+                return;
+
+            if (guard->m_count == guard->m_capacity)
+            {
+                bool const grown = env_guard_grow(guard);
+                ASSERT(grown);
+                if (!grown)
+                    return;
+            }
+
+            uint_t      size  = 0;
+            char const* value = env_native_acquire(name, &size);
+
+            // "name\0value\0"
+            uint_t const bytes = len + 1 + (value ? size + 1 : 0);
+            char*        copy  = (char*)context_t::system_alloc()->allocate((u32)bytes, 1);
+            if (copy)
+            {
+                memcpy(copy, name, len + 1);
+                if (value)
+                    memcpy(copy + len + 1, value, size + 1);
+
+                env_record_t& r = guard->m_records[guard->m_count];
+                r.m_name        = copy;
+                r.m_value       = value ? copy + len + 1 : null;
+                r.m_name_len    = len;
+                r.m_hash        = hash;
+
+                u32 slot = hash & (guard->m_slots - 1);
+                while (guard->m_index[slot] != 0)
+                    slot = (slot + 1) & (guard->m_slots - 1);
+                guard->m_index[slot] = ++guard->m_count;
+            }
+            env_native_release(value);
+            ASSERT(copy);
+        }
+
+        void env_guard_rollback(env_guard_t* guard)
+        {
+            // a guard that could not begin has nothing to restore
+            if (!guard)
+                return;
+
+            // check
+            ASSERT(guard == s_guard);
+            if (guard != s_guard)
+                return;
+
+            // the subscribers see the whole rollback as one batch
+            env_batch_begin();
+
+            // newest first, like unwinding, there is one record per variable so the outcome does
+            // not depend on the order
+            alloc_t* allocator = context_t::system_alloc();
+            for (u32 i = guard->m_count; i-- > 0;)
+            {
+                env_record_t const& r = guard->m_records[i];
+
+                // only touch the variables that are not back at their old value
+                uint_t      size    = 0;
+                char const* current = env_native_acquire(r.m_name, &size);
+                bool const  same    = r.m_value ? (current && strcmp(current, r.m_value) == 0) : (current == null);
+                env_native_release(current);
+                if (!same)
+                {
+                    env_watch_before(r.m_name);
+                    env_fingerprint_before(r.m_name);
+                    env_native_set(r.m_name, r.m_value);
+                    env_fingerprint_after(r.m_name);
+                    env_watch_after(r.m_name);
+                }
+
+                allocator->deallocate(r.m_name);
+            }
+
+            guard->m_count = 0;
+            if (guard->m_index)
+                memset(guard->m_index, 0, guard->m_slots * sizeof(u32));
+
+            env_batch_end();
+        }
+
+        void env_guard_end(env_guard_t* guard)
+        {
+            // a guard that could not begin has nothing to end
+            if (!guard)
+                return;
+
+            // check
+            ASSERT(guard == s_guard);
+            if (guard != s_guard)
+                return;
+
+            env_guard_rollback(guard);
+
+            alloc_t* allocator = context_t::system_alloc();
+            if (guard->m_records)
+                allocator->deallocate(guard->m_records);
+            if (guard->m_index)
+                allocator->deallocate(guard->m_index);
+
+            s_guard = guard->m_parent;
+            allocator->deallocate(guard);
+        }
+
+        uint_t env_guard_size(env_guard_t const* guard) { return guard ? guard->m_count : 0; }
+
+    } // namespace nenv
+} // namespace ncore
@@ -0,0 +1,254 @@
+#include "ccore/c_target.h"
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+#    include <stdio.h>
+#    include <stdlib.h>
+#    include <string.h>
+#    include <sys/types.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <fcntl.h>
+#    include <unistd.h>
+extern char** environ;
+
+#    include "cbase/c_context.h"
+#    include "cenv/c_env_shm.h"
+#    include "cenv/private/c_env_snapshot_layout.h"
+#    include "cenv/private/c_assert.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+#    define CENV_SHM_MAGIC 0x4D484543 // 'CEHM'
+
+        // the segment header, followed by the two snapshot buffers
+        struct env_shm_header_t
+        {
+            u32 m_magic;
+            u32 m_header;   // offset of the first buffer
+            u64 m_capacity; // size of a buffer
+            u64 m_version;  // current version, lives in buffer (version & 1)
+            u64 m_seq[2];   // per buffer sequence, odd while the buffer is written
+        };
+
+        struct env_shm_t
+        {
+            env_shm_header_t* m_header;
+            uint_t            m_size;
+            int               m_fd;
+            bool              m_writable;
+            u32               m_flags; // the snapshot flags of the publisher
+        };
+
+        static inline u64 env_shm_load(u64 const* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+        static inline void env_shm_store(u64* p, u64 v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+        static inline env_snapshot_t const* env_shm_buffer(env_shm_header_t const* header, u32 buffer) { return (env_snapshot_t const*)((u8 const*)header + header->m_header + buffer * header->m_capacity); }
+
+        static int env_shm_open_fd()
+        {
+#    if defined(TARGET_LINUX)
+            return memfd_create("cenv", 0);
+#    else
+            // an anonymous segment, the name is removed as soon as we have the descriptor
+            char name[64];
+            snprintf(name, sizeof(name), "/cenv.%d.%p", (int)getpid(), (void*)&name);
+            int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd >= 0)
+                shm_unlink(name);
+            return fd;
+#    endif
+        }
+
+        static env_shm_t* env_shm_map(int fd, uint_t size, bool writable)
+        {
+            void* mem = mmap(null, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+            check_return_val(mem != MAP_FAILED, null);
+
+            env_shm_t* shm = (env_shm_t*)context_t::system_alloc()->allocate(sizeof(env_shm_t));
+            if (!shm)
+            {
+                munmap(mem, size);
+                return null;
+            }
+            shm->m_header   = (env_shm_header_t*)mem;
+            shm->m_size     = size;
+            shm->m_fd       = fd;
+            shm->m_writable = writable;
+            shm->m_flags    = env_snapshot_default;
+            return shm;
+        }
+
+        env_shm_t* env_shm_create(uint_t capacity, u32 flags)
+        {
+            // check
+            assert_and_check_return_val(capacity >= sizeof(env_snapshot_t), null);
+
+            capacity           = (capacity + 63) & ~(uint_t)63;
+            uint_t const start = (sizeof(env_shm_header_t) + 63) & ~(uint_t)63;
+            uint_t const size  = start + capacity * 2;
+
+            int fd = env_shm_open_fd();
+            check_return_val(fd >= 0, null);
+            if (ftruncate(fd, (off_t)size) != 0)
+            {
+                close(fd);
+                return null;
+            }
+
+            env_shm_t* shm = env_shm_map(fd, size, true);
+            if (!shm)
+            {
+                close(fd);
+                return null;
+            }
+            shm->m_flags = flags;
+
+            // a fresh segment is zero filled, version 0 means nothing published
+            env_shm_header_t* header = shm->m_header;
+            header->m_header         = (u32)start;
+            header->m_capacity       = capacity;
+            __atomic_store_n(&header->m_magic, (u32)CENV_SHM_MAGIC, __ATOMIC_RELEASE);
+            return shm;
+        }
+
+        env_shm_t* env_shm_attach(int fd)
+        {
+            // check
+            assert_and_check_return_val(fd >= 0, null);
+
+            struct stat st;
+            check_return_val(fstat(fd, &st) == 0 && (uint_t)st.st_size >= sizeof(env_shm_header_t), null);
+
+            env_shm_t* shm = env_shm_map(fd, (uint_t)st.st_size, false);
+            check_return_val(shm, null);
+
+            env_shm_header_t const* header = shm->m_header;
+            if (__atomic_load_n(&header->m_magic, __ATOMIC_ACQUIRE) != CENV_SHM_MAGIC || header->m_header + header->m_capacity * 2 > shm->m_size)
+            {
+                // not ours, leave the descriptor to the caller
+                shm->m_fd = -1;
+                env_shm_close(shm);
+                return null;
+            }
+            return shm;
+        }
+
+        void env_shm_close(env_shm_t* shm)
+        {
+            if (!shm)
+                return;
+            munmap(shm->m_header, shm->m_size);
+            if (shm->m_fd >= 0)
+                close(shm->m_fd);
+            context_t::system_alloc()->deallocate(shm);
+        }
+
+        int env_shm_fd(env_shm_t const* shm) { return shm ? shm->m_fd : -1; }
+
+        u64 env_shm_version(env_shm_t const* shm) { return shm ? env_shm_load(&shm->m_header->m_version) : 0; }
+
+        u64 env_shm_publish(env_shm_t* shm, char const* const* vars, uint_t count)
+        {
+            // check
+            assert_and_check_return_val(shm && shm->m_writable, 0);
+
+            env_shm_header_t* header  = shm->m_header;
+            u64 const         version = header->m_version + 1;
+            u32 const         buffer  = (u32)(version & 1);
+
+            // the snapshot must fit, measuring first keeps the current buffers intact
+            uint_t const bytes = env_snapshot_measure(vars, count);
+            check_return_val(bytes && bytes <= header->m_capacity, 0);
+
+            // open the buffer for writing, readers still on it will notice
+            u64 const seq = header->m_seq[buffer];
+            env_shm_store(&header->m_seq[buffer], seq + 1);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+            void* mem = (void*)env_shm_buffer(header, buffer);
+            env_snapshot_build(mem, (uint_t)header->m_capacity, vars, count, shm->m_flags);
+
+            // close the buffer and make it current
+            env_shm_store(&header->m_seq[buffer], seq + 2);
+            env_shm_store(&header->m_version, version);
+            return version;
+        }
+
+        u64 env_shm_publish_live(env_shm_t* shm)
+        {
+            uint_t count = 0;
+            while (environ && environ[count])
+                count++;
+            return env_shm_publish(shm, (char const* const*)environ, count);
+        }
+
+        void env_shm_reader_init(env_shm_reader_t* reader, env_shm_t* shm)
+        {
+            reader->m_shm     = shm;
+            reader->m_snap    = null;
+            reader->m_version = 0;
+            reader->m_seq     = 0;
+            reader->m_buffer  = 0;
+            env_shm_refresh(reader);
+        }
+
+        bool env_shm_refresh(env_shm_reader_t* reader)
+        {
+            env_shm_header_t const* header = reader->m_shm->m_header;
+            while (true)
+            {
+                u64 const version = env_shm_load(&header->m_version);
+                if (version == reader->m_version && reader->m_snap)
+                    return false;
+                if (version == 0)
+                    return false;
+
+                // the buffer is odd while the publisher is already writing the version after next
+                u32 const buffer = (u32)(version & 1);
+                u64 const seq    = env_shm_load(&header->m_seq[buffer]);
+                if (seq & 1)
+                    continue;
+
+                reader->m_version = version;
+                reader->m_buffer  = buffer;
+                reader->m_seq     = seq;
+                reader->m_snap    = env_shm_buffer(header, buffer);
+                return true;
+            }
+        }
+
+        bool env_shm_valid(env_shm_reader_t const* reader)
+        {
+            check_return_val(reader->m_snap, false);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            return __atomic_load_n(&reader->m_shm->m_header->m_seq[reader->m_buffer], __ATOMIC_RELAXED) == reader->m_seq;
+        }
+
+        bool env_shm_find(env_shm_reader_t* reader, char const* name, env_view_t* value)
+        {
+            // check
+            assert_and_check_return_val(reader && name && value, false);
+
+            uint_t const len      = strlen(name);
+            uint_t const capacity = (uint_t)reader->m_shm->m_header->m_capacity;
+            while (true)
+            {
+                check_return_val(reader->m_snap, false);
+
+                // the lookup is bounded by the buffer, a torn read is detected by the sequence
+                bool const found = env_snapshot_find_bounded(reader->m_snap, capacity, name, len, value);
+                if (env_shm_valid(reader))
+                    return found;
+
+                reader->m_snap = null;
+                env_shm_refresh(reader);
+            }
+        }
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif
@@ -0,0 +1,573 @@
+#include "ccore/c_target.h"
+
+#if defined TARGET_PC
+#    include "kernel32.h"
+#else
+#    include <stdlib.h>
+#    include <unistd.h>
+extern char** environ;
+#endif
+
+#include <string.h>
+
+#if !defined(CENV_SNAPSHOT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#    define CENV_SNAPSHOT_SSE2
+#    include <emmintrin.h>
+#endif
+
+#include "cbase/c_context.h"
+#include "cenv/c_env_snapshot.h"
+#include "cenv/c_env_utf.h"
+#include "cenv/private/c_env_snapshot_layout.h"
+#include "cenv/private/c_assert.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        static inline u32 env_align(u32 size, u32 alignment) { return (size + (alignment - 1)) & ~(alignment - 1); }
+
+#if defined(CENV_SNAPSHOT_SSE2)
+        // fold the ASCII letters of 16 bytes to lower case, the signed compares leave bytes >= 0x80 alone
+        static inline __m128i env_fold_16(__m128i v)
+        {
+            __m128i const upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+            return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+        }
+
+        // 16 bytes as two words, folded at once
+        static inline void env_load_16(u8 const* p, bool fold, u64* a, u64* b)
+        {
+            __m128i v = _mm_loadu_si128((__m128i const*)p);
+            if (fold)
+                v = env_fold_16(v);
+            u64 w[2];
+            _mm_storeu_si128((__m128i*)w, v);
+            *a = w[0];
+            *b = w[1];
+        }
+
+        // are 16 bytes equal with the ASCII letters folded, they are only folded when they differ
+        static inline bool env_block_equal_folded(u8 const* a, u8 const* b)
+        {
+            __m128i const va = _mm_loadu_si128((__m128i const*)a);
+            __m128i const vb = _mm_loadu_si128((__m128i const*)b);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF)
+                return true;
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(env_fold_16(va), env_fold_16(vb))) == 0xFFFF;
+        }
+#else
+        static inline void env_load_16(u8 const* p, bool fold, u64* a, u64* b)
+        {
+            *a = env_load_word(p, 8);
+            *b = env_load_word(p + 8, 8);
+            if (fold)
+            {
+                *a = env_fold_word(*a);
+                *b = env_fold_word(*b);
+            }
+        }
+#endif
+
+        static inline bool env_word_equal_folded(u64 a, u64 b) { return a == b || env_fold_word(a) == env_fold_word(b); }
+
+        static inline u64 env_hash_round(u64 h, u64 w)
+        {
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            return h ^ (h >> 32);
+        }
+
+        static inline u32 env_hash_words(char const* name, uint_t len, bool fold)
+        {
+            // two lanes of 8 bytes, 16 bytes per step. the last step takes the last 16 bytes,
+            // overlapping the step before, and shorter names are loaded without reading past them
+            u8 const* p  = (u8 const*)name;
+            u64       h0 = 0x9E3779B97F4A7C15ull ^ ((u64)len * 0xC2B2AE3D27D4EB4Full);
+            u64       h1 = 0x8EBC6AF09C88C6E3ull;
+            u64       a, b;
+            if (len > 16)
+            {
+                u8 const* last = p + len - 16;
+                for (; p < last; p += 16)
+                {
+                    env_load_16(p, fold, &a, &b);
+                    h0 = env_hash_round(h0, a);
+                    h1 = env_hash_round(h1, b);
+                }
+                env_load_16(last, fold, &a, &b);
+            }
+            else
+            {
+                a = len > 8 ? env_load_word(p, 8) : env_load_short(p, len);
+                b = len > 8 ? env_load_word(p + len - 8, 8) : 0;
+                if (fold)
+                {
+                    a = env_fold_word(a);
+                    b = env_fold_word(b);
+                }
+            }
+            u64 h = env_hash_round(h0, a) ^ (env_hash_round(h1, b) * 0xC2B2AE3D27D4EB4Full);
+            h ^= h >> 33;
+            h *= 0xC4CEB9FE1A85EC53ull;
+            h ^= h >> 33;
+            return (u32)h;
+        }
+
+        u32 env_hash_name(char const* name, uint_t len) { return env_hash_words(name, len, false); }
+        u32 env_hash_name_folded(char const* name, uint_t len) { return env_hash_words(name, len, true); }
+
+        bool env_name_equal_folded(char const* a, char const* b, uint_t len)
+        {
+            // the last block or word overlaps the one before, the first one that differs ends it
+            u8 const* pa = (u8 const*)a;
+            u8 const* pb = (u8 const*)b;
+#if defined(CENV_SNAPSHOT_SSE2)
+            if (len >= 16)
+            {
+                for (uint_t i = 0; i < len - 16; i += 16)
+                {
+                    if (!env_block_equal_folded(pa + i, pb + i))
+                        return false;
+                }
+                return env_block_equal_folded(pa + len - 16, pb + len - 16);
+            }
+#endif
+            if (len >= 8)
+            {
+                for (uint_t i = 0; i < len - 8; i += 8)
+                {
+                    if (!env_word_equal_folded(env_load_word(pa + i, 8), env_load_word(pb + i, 8)))
+                        return false;
+                }
+                return env_word_equal_folded(env_load_word(pa + len - 8, 8), env_load_word(pb + len - 8, 8));
+            }
+            return env_word_equal_folded(env_load_short(pa, len), env_load_short(pb, len));
+        }
+
+        // the length of the name part of "NAME=VALUE", 0 if this is not a variable
+        static uint_t env_var_name_len(char const* var)
+        {
+            // windows keeps hidden "=C:=C:\\" entries, these are not variables
+            if (!var || var[0] == '=' || var[0] == '\0')
+                return 0;
+            char const* eq = strchr(var, '=');
+            return eq ? (uint_t)(eq - var) : 0;
+        }
+
+        // compare the first n bytes, with the ASCII letters folded to lower case when fold is set
+        static s32 env_bytes_compare(char const* a, char const* b, u32 n, bool fold)
+        {
+            if (!fold)
+                return memcmp(a, b, n);
+
+            // skip the words that are equal, then find the first byte that is not
+            u8 const* pa = (u8 const*)a;
+            u8 const* pb = (u8 const*)b;
+            u32       i  = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                if (env_fold_word(env_load_word(pa + i, 8)) != env_fold_word(env_load_word(pb + i, 8)))
+                    break;
+            }
+            for (; i < n; ++i)
+            {
+                u8 const ca = env_fold_char(pa[i]);
+                u8 const cb = env_fold_char(pb[i]);
+                if (ca != cb)
+                    return ca < cb ? -1 : 1;
+            }
+            return 0;
+        }
+
+        s32 env_name_compare(char const* a, u32 alen, char const* b, u32 blen, bool fold)
+        {
+            s32 const c = env_bytes_compare(a, b, alen < blen ? alen : blen, fold);
+            if (c != 0)
+                return c;
+            return alen < blen ? -1 : (alen > blen ? 1 : 0);
+        }
+
+        // names are ordered, equal names keep their original order so that the first one wins
+        static s32 env_entry_compare(char const* blob, env_entry_t const& a, env_entry_t const& b, bool fold)
+        {
+            s32 const c = env_name_compare(blob + a.m_name, a.m_name_len, blob + b.m_name, b.m_name_len, fold);
+            if (c != 0)
+                return c;
+            return a.m_name < b.m_name ? -1 : (a.m_name > b.m_name ? 1 : 0);
+        }
+
+        static void env_entry_sift(char const* blob, env_entry_t* entries, u32 root, u32 count, bool fold)
+        {
+            while (true)
+            {
+                u32 child = root * 2 + 1;
+                if (child >= count)
+                    break;
+                if (child + 1 < count && env_entry_compare(blob, entries[child], entries[child + 1], fold) < 0)
+                    child++;
+                if (env_entry_compare(blob, entries[root], entries[child], fold) >= 0)
+                    break;
+                env_entry_t const t = entries[root];
+                entries[root]       = entries[child];
+                entries[child]      = t;
+                root                = child;
+            }
+        }
+
+        static void env_entry_sort(char const* blob, env_entry_t* entries, u32 count, bool fold)
+        {
+            // heap sort, in place and without any allocation
+            for (u32 i = count / 2; i > 0; --i)
+                env_entry_sift(blob, entries, i - 1, count, fold);
+            for (u32 i = count; i > 1; --i)
+            {
+                env_entry_t const t = entries[0];
+                entries[0]          = entries[i - 1];
+                entries[i - 1]      = t;
+                env_entry_sift(blob, entries, 0, i - 1, fold);
+            }
+        }
+
+        struct env_layout_t
+        {
+            u32 m_count;
+            u32 m_slots;
+            u32 m_entries;
+            u32 m_index;
+            u32 m_blob;
+            u32 m_bytes;
+        };
+
+        static bool env_snapshot_layout(char const* const* vars, uint_t count, env_layout_t* layout)
+        {
+            u64 n    = 0;
+            u64 blob = 0;
+            for (uint_t i = 0; i < count; ++i)
+            {
+                if (env_var_name_len(vars[i]) == 0)
+                    continue;
+                blob += strlen(vars[i]) + 1;
+                n++;
+            }
+
+            // keep the index at most half full
+            u64 slots = 4;
+            while (slots < n * 2)
+                slots <<= 1;
+
+            u64 const entries = env_align(sizeof(env_snapshot_t), 8);
+            u64 const index   = entries + n * sizeof(env_entry_t);
+            u64 const strings = index + slots * sizeof(u32);
+            u64 const bytes   = (strings + blob + 7) & ~(u64)7;
+            check_return_val(bytes <= 0xFFFFFFFFull, false);
+
+            layout->m_count   = (u32)n;
+            layout->m_slots   = (u32)slots;
+            layout->m_entries = (u32)entries;
+            layout->m_index   = (u32)index;
+            layout->m_blob    = (u32)strings;
+            layout->m_bytes   = (u32)bytes;
+            return true;
+        }
+
+        uint_t env_snapshot_measure(char const* const* vars, uint_t count)
+        {
+            env_layout_t layout;
+            if (!env_snapshot_layout(vars, count, &layout))
+                return 0;
+            return layout.m_bytes;
+        }
+
+        env_snapshot_t const* env_snapshot_build(void* mem, uint_t size, char const* const* vars, uint_t count, u32 flags)
+        {
+            // check
+            assert_and_check_return_val(mem && (vars || !count), null);
+            assert_and_check_return_val(((uint_t)mem & 7) == 0, null);
+
+            env_layout_t layout;
+            check_return_val(env_snapshot_layout(vars, count, &layout), null);
+            check_return_val(layout.m_bytes <= size, null);
+
+            bool const      fold    = (flags & env_snapshot_case_insensitive) != 0;
+            u8*             base    = (u8*)mem;
+            env_snapshot_t* snap    = (env_snapshot_t*)base;
+            env_entry_t*    entries = (env_entry_t*)(base + layout.m_entries);
+            u32*            index   = (u32*)(base + layout.m_index);
+            char*           blob    = (char*)(base + layout.m_blob);
+
+            // copy the strings, "NAME=VALUE" becomes "NAME\0VALUE\0"
+            u32 n      = 0;
+            u32 offset = 0;
+            for (uint_t i = 0; i < count; ++i)
+            {
+                uint_t const name_len = env_var_name_len(vars[i]);
+                if (name_len == 0)
+                    continue;
+
+                uint_t const len = strlen(vars[i]);
+                memcpy(blob + offset, vars[i], len + 1);
+                blob[offset + name_len] = '\0';
+
+                env_entry_t& e = entries[n++];
+                e.m_name       = offset;
+                e.m_name_len   = (u32)name_len;
+                e.m_value      = offset + (u32)name_len + 1;
+                e.m_value_len  = (u32)(len - name_len - 1);
+                e.m_hash       = fold ? env_hash_name_folded(vars[i], name_len) : env_hash_name(vars[i], name_len);
+                offset += (u32)len + 1;
+            }
+
+            // sort by name and drop the duplicates
+            env_entry_sort(blob, entries, n, fold);
+            u32 unique = 0;
+            for (u32 i = 0; i < n; ++i)
+            {
+                if (unique > 0 && env_name_compare(blob + entries[unique - 1].m_name, entries[unique - 1].m_name_len, blob + entries[i].m_name, entries[i].m_name_len, fold) == 0)
+                    continue;
+                entries[unique++] = entries[i];
+            }
+
+            // build the hash index, a slot holds the entry index + 1, 0 is empty
+            u32 const mask = layout.m_slots - 1;
+            memset(index, 0, layout.m_slots * sizeof(u32));
+            for (u32 i = 0; i < unique; ++i)
+            {
+                u32 slot = entries[i].m_hash & mask;
+                while (index[slot] != 0)
+                    slot = (slot + 1) & mask;
+                index[slot] = i + 1;
+            }
+
+            snap->m_magic   = CENV_SNAPSHOT_MAGIC;
+            snap->m_flags   = flags;
+            snap->m_count   = unique;
+            snap->m_slots   = layout.m_slots;
+            snap->m_bytes   = layout.m_bytes;
+            snap->m_entries = layout.m_entries;
+            snap->m_index   = layout.m_index;
+            snap->m_blob    = layout.m_blob;
+            return snap;
+        }
+
+        static env_snapshot_t* env_snapshot_create_from(char const* const* vars, uint_t count, u32 flags)
+        {
+            uint_t const bytes = env_snapshot_measure(vars, count);
+            check_return_val(bytes, null);
+
+            alloc_t* allocator = context_t::system_alloc();
+            void*    mem       = allocator->allocate((u32)bytes, 8);
+            check_return_val(mem, null);
+
+            env_snapshot_t const* snap = env_snapshot_build(mem, bytes, vars, count, flags);
+            if (!snap)
+            {
+                allocator->deallocate(mem);
+                return null;
+            }
+            return (env_snapshot_t*)snap;
+        }
+
+#if defined(TARGET_PC)
+
+        static inline uint_t env_wide_len(wchar_t const* str)
+        {
+            wchar_t const* p = str;
+            while (*p)
+                p++;
+            return (uint_t)(p - str);
+        }
+
+        env_snapshot_t* env_snapshot_create(u32 flags)
+        {
+            // names are case-insensitive on windows
+            flags |= env_snapshot_case_insensitive;
+
+            // the environment block is "NAME=VALUE\0NAME=VALUE\0\0" in UTF-16, the W api is the
+            // only one that sees every variable, the A api goes through the ANSI codepage
+            wchar_t* block = kernel32()->GetEnvironmentStringsW();
+            check_return_val(block, null);
+
+            // the UTF-8 size of every variable, variables that do not convert are skipped like
+            // env_get does with their values
+            uint_t count = 0;
+            uint_t bytes = 0;
+            for (wchar_t const* p = block; *p;)
+            {
+                uint_t const len  = env_wide_len(p);
+                uint_t const size = env_utf16_to_utf8_len((u16 const*)p, len);
+                if (size != env_utf_invalid)
+                {
+                    count++;
+                    bytes += size + 1;
+                }
+                p += len + 1;
+            }
+
+            // one allocation, the pointers and the UTF-8 strings
+            env_snapshot_t* snap      = null;
+            alloc_t*        allocator = context_t::system_alloc();
+            char const**    vars      = (char const**)allocator->allocate((u32)((count + 1) * sizeof(char const*) + bytes));
+            if (vars)
+            {
+                char*  str = (char*)(vars + count + 1);
+                uint_t i   = 0;
+                for (wchar_t const* p = block; *p && i < count;)
+                {
+                    uint_t const len  = env_wide_len(p);
+                    uint_t const size = env_utf16_to_utf8_len((u16 const*)p, len);
+                    if (size != env_utf_invalid)
+                    {
+                        env_utf16_to_utf8((u16 const*)p, len, str);
+                        str[size] = '\0';
+                        vars[i++] = str;
+                        str += size + 1;
+                    }
+                    p += len + 1;
+                }
+                snap = env_snapshot_create_from(vars, count, flags);
+                allocator->deallocate(vars);
+            }
+
+            kernel32()->FreeEnvironmentStringsW(block);
+            return snap;
+        }
+
+#else
+
+        env_snapshot_t* env_snapshot_create(u32 flags)
+        {
+            uint_t count = 0;
+            while (environ && environ[count])
+                count++;
+            return env_snapshot_create_from((char const* const*)environ, count, flags);
+        }
+
+#endif
+
+        void env_snapshot_destroy(env_snapshot_t* snap)
+        {
+            if (snap)
+                context_t::system_alloc()->deallocate(snap);
+        }
+
+        uint_t env_snapshot_bytes(env_snapshot_t const* snap) { return snap ? snap->m_bytes : 0; }
+        uint_t env_snapshot_size(env_snapshot_t const* snap) { return snap ? snap->m_count : 0; }
+
+        bool env_snapshot_at(env_snapshot_t const* snap, uint_t index, env_view_t* name, env_view_t* value)
+        {
+            // check
+            assert_and_check_return_val(snap, false);
+            check_return_val(index < snap->m_count, false);
+
+            u8 const*          base = (u8 const*)snap;
+            env_entry_t const& e    = ((env_entry_t const*)(base + snap->m_entries))[index];
+            char const*        blob = (char const*)(base + snap->m_blob);
+            if (name)
+            {
+                name->m_str = blob + e.m_name;
+                name->m_len = e.m_name_len;
+            }
+            if (value)
+            {
+                value->m_str = blob + e.m_value;
+                value->m_len = e.m_value_len;
+            }
+            return true;
+        }
+
+        bool env_snapshot_find_bounded(env_snapshot_t const* snap, uint_t limit, char const* name, uint_t len, env_view_t* value)
+        {
+            check_return_val(limit >= sizeof(env_snapshot_t), false);
+
+            // read the header once, it may change underneath us
+            u32 const flags   = snap->m_flags;
+            u32 const count   = snap->m_count;
+            u32 const slots   = snap->m_slots;
+            u64 const bytes   = snap->m_bytes;
+            u64 const entries = snap->m_entries;
+            u64 const index   = snap->m_index;
+            u64 const strings = snap->m_blob;
+            check_return_val(bytes <= limit && slots != 0 && (slots & (slots - 1)) == 0, false);
+            check_return_val(entries + (u64)count * sizeof(env_entry_t) <= bytes, false);
+            check_return_val(index + (u64)slots * sizeof(u32) <= bytes && strings <= bytes, false);
+
+            u8 const*   base = (u8 const*)snap;
+            u32 const*  tbl  = (u32 const*)(base + index);
+            char const* blob = (char const*)(base + strings);
+
+            bool const fold = (flags & env_snapshot_case_insensitive) != 0;
+            u32 const  hash = fold ? env_hash_name_folded(name, len) : env_hash_name(name, len);
+            u32 const  mask = slots - 1;
+            u32        slot = hash & mask;
+            for (u32 probe = 0; probe < slots; ++probe, slot = (slot + 1) & mask)
+            {
+                u32 const i = tbl[slot];
+                if (i == 0 || i > count)
+                    return false;
+
+                env_entry_t const e = ((env_entry_t const*)(base + entries))[i - 1];
+                if (e.m_hash != hash || e.m_name_len != len)
+                    continue;
+                if (strings + e.m_name + e.m_name_len >= bytes || strings + e.m_value + e.m_value_len >= bytes)
+                    return false;
+                if (fold ? !env_name_equal_folded(blob + e.m_name, name, len) : memcmp(blob + e.m_name, name, len) != 0)
+                    continue;
+
+                value->m_str = blob + e.m_value;
+                value->m_len = e.m_value_len;
+                return true;
+            }
+            return false;
+        }
+
+        bool env_snapshot_find(env_snapshot_t const* snap, char const* name, env_view_t* value)
+        {
+            // check
+            assert_and_check_return_val(snap && name && value, false);
+            return env_snapshot_find_bounded(snap, snap->m_bytes, name, strlen(name), value);
+        }
+
+        // compare the start of a name with a prefix, 0 when the name starts with the prefix
+        static s32 env_prefix_compare(char const* name, u32 name_len, char const* prefix, uint_t prefix_len, bool fold)
+        {
+            s32 const c = env_bytes_compare(name, prefix, (u32)(name_len < prefix_len ? name_len : prefix_len), fold);
+            if (c != 0)
+                return c;
+            return name_len < prefix_len ? -1 : 0;
+        }
+
+        // the first entry for which the prefix compare is >= 0 (upper == false) or > 0 (upper == true)
+        static u32 env_prefix_search(env_snapshot_t const* snap, char const* prefix, uint_t prefix_len, bool upper)
+        {
+            u8 const*          base    = (u8 const*)snap;
+            env_entry_t const* entries = (env_entry_t const*)(base + snap->m_entries);
+            char const*        blob    = (char const*)(base + snap->m_blob);
+            bool const         fold    = (snap->m_flags & env_snapshot_case_insensitive) != 0;
+
+            u32 lo = 0;
+            u32 hi = snap->m_count;
+            while (lo < hi)
+            {
+                u32 const mid = lo + (hi - lo) / 2;
+                s32 const c   = env_prefix_compare(blob + entries[mid].m_name, entries[mid].m_name_len, prefix, prefix_len, fold);
+                if (upper ? (c <= 0) : (c < 0))
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        bool env_snapshot_prefix(env_snapshot_t const* snap, char const* prefix, uint_t* first, uint_t* end)
+        {
+            // check
+            assert_and_check_return_val(snap && prefix && first && end, false);
+
+            uint_t const prefix_len = strlen(prefix);
+            *first                  = env_prefix_search(snap, prefix, prefix_len, false);
+            *end                    = env_prefix_search(snap, prefix, prefix_len, true);
+            return *first < *end;
+        }
+
+    } // namespace nenv
+} // namespace ncore
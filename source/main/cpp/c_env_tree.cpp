@@ -0,0 +1,319 @@
+#include "ccore/c_target.h"
+
+#include <string.h>
+
+#include "cbase/c_context.h"
+#include "cenv/c_env_tree.h"
+#include "cenv/private/c_assert.h"
+#include "cenv/private/c_env_snapshot_layout.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        struct env_tree_t
+        {
+            env_node_t* m_nodes; // m_nodes[0] is the root
+            u32         m_count;
+        };
+
+        // a node while the tree is built, the children are linked in the order they are found
+        struct env_tree_build_node_t
+        {
+            env_view_t m_key;
+            env_view_t m_value;
+            u32        m_hash;
+            u32        m_parent;
+            u32        m_child; // 0 is none, the root is never a child
+            u32        m_next;
+            u32        m_last;
+            u32        m_count;
+        };
+
+        struct env_tree_builder_t
+        {
+            env_tree_build_node_t* m_nodes;
+            u32*                   m_index; // open addressing over (parent, key), node index, 0 is empty
+            u32*                   m_order; // the build index of every node of the tree
+            u32                    m_slots; // power of two
+            u32                    m_count;
+            u32                    m_capacity;
+            bool                   m_fold; // the snapshot is case-insensitive
+        };
+
+        static inline bool env_key_equal(char const* a, char const* b, u32 len, bool fold) { return fold ? env_name_equal_folded(a, b, len) : memcmp(a, b, len) == 0; }
+
+        // the length of the segment that starts at str, it ends at the delimiter or at the end
+        static u32 env_segment_len(char const* str, u32 len, char const* delimiter, u32 delimiter_len, bool fold)
+        {
+            for (u32 i = 0; i + delimiter_len <= len; ++i)
+            {
+                if (env_key_equal(str + i, delimiter, delimiter_len, fold))
+                    return i;
+            }
+            return len;
+        }
+
+        static u32 env_segment_count(char const* str, u32 len, char const* delimiter, u32 delimiter_len, bool fold)
+        {
+            u32 count = 1;
+            while (true)
+            {
+                u32 const seg = env_segment_len(str, len, delimiter, delimiter_len, fold);
+                if (seg == len)
+                    return count;
+                str += seg + delimiter_len;
+                len -= seg + delimiter_len;
+                count++;
+            }
+        }
+
+        static u32 env_tree_child_of(env_tree_builder_t* b, u32 parent, char const* key, u32 key_len)
+        {
+            // the names are sorted, the child is most often the one that was found last
+            env_tree_build_node_t* nodes = b->m_nodes;
+            u32 const              last  = nodes[parent].m_last;
+            if (last && nodes[last].m_key.m_len == key_len && env_key_equal(nodes[last].m_key.m_str, key, key_len, b->m_fold))
+                return last;
+
+            // "A", "A0" and "A__B" come in this order, a key can come back after a sibling
+            u32 const hash = (b->m_fold ? env_hash_name_folded(key, key_len) : env_hash_name(key, key_len)) ^ (parent * 0x9E3779B1u);
+            u32 const mask = b->m_slots - 1;
+            u32       slot = hash & mask;
+            for (;; slot = (slot + 1) & mask)
+            {
+                u32 const i = b->m_index[slot];
+                if (i == 0)
+                    break;
+                env_tree_build_node_t const& n = nodes[i];
+                if (n.m_hash == hash && n.m_parent == parent && n.m_key.m_len == key_len && env_key_equal(n.m_key.m_str, key, key_len, b->m_fold))
+                    return i;
+            }
+
+            ASSERT(b->m_count < b->m_capacity);
+            u32 const              i    = b->m_count++;
+            env_tree_build_node_t& node = nodes[i];
+            node.m_key.m_str            = key;
+            node.m_key.m_len            = key_len;
+            node.m_value.m_str          = null;
+            node.m_value.m_len          = 0;
+            node.m_hash                 = hash;
+            node.m_parent               = parent;
+            node.m_child                = 0;
+            node.m_next                 = 0;
+            node.m_last                 = 0;
+            node.m_count                = 0;
+            if (last)
+                nodes[last].m_next = i;
+            else
+                nodes[parent].m_child = i;
+            nodes[parent].m_last = i;
+            nodes[parent].m_count++;
+            b->m_index[slot] = i;
+            return i;
+        }
+
+        static inline s32 env_tree_key_compare(env_tree_build_node_t const* nodes, u32 a, u32 b, bool fold)
+        {
+            return env_name_compare(nodes[a].m_key.m_str, nodes[a].m_key.m_len, nodes[b].m_key.m_str, nodes[b].m_key.m_len, fold);
+        }
+
+        static void env_tree_sift(env_tree_build_node_t const* nodes, u32* order, u32 root, u32 count, bool fold)
+        {
+            while (true)
+            {
+                u32 child = root * 2 + 1;
+                if (child >= count)
+                    break;
+                if (child + 1 < count && env_tree_key_compare(nodes, order[child], order[child + 1], fold) < 0)
+                    child++;
+                if (env_tree_key_compare(nodes, order[root], order[child], fold) >= 0)
+                    break;
+                u32 const t  = order[root];
+                order[root]  = order[child];
+                order[child] = t;
+                root         = child;
+            }
+        }
+
+        // order siblings by key, their keys are unique
+        static void env_tree_sort(env_tree_build_node_t const* nodes, u32* order, u32 count, bool fold)
+        {
+            // the siblings mostly come in order, check that first
+            u32 i = 1;
+            while (i < count && env_tree_key_compare(nodes, order[i - 1], order[i], fold) < 0)
+                i++;
+            if (i >= count)
+                return;
+
+            // heap sort, like the snapshot entries
+            for (u32 j = count / 2; j > 0; --j)
+                env_tree_sift(nodes, order, j - 1, count, fold);
+            for (u32 j = count; j > 1; --j)
+            {
+                u32 const t  = order[0];
+                order[0]     = order[j - 1];
+                order[j - 1] = t;
+                env_tree_sift(nodes, order, 0, j - 1, fold);
+            }
+        }
+
+        static void env_tree_node_init(env_node_t* node, env_tree_build_node_t const& from, bool fold)
+        {
+            node->m_key         = from.m_key;
+            node->m_value       = from.m_value;
+            node->m_child       = null;
+            node->m_next        = null;
+            node->m_child_count = 0;
+            node->m_fold        = fold;
+        }
+
+        env_tree_t* env_tree_build(env_snapshot_t const* snap, char const* prefix, char const* delimiter)
+        {
+            // check
+            assert_and_check_return_val(snap && prefix && delimiter && delimiter[0], null);
+
+            uint_t first = 0, end = 0;
+            env_snapshot_prefix(snap, prefix, &first, &end);
+
+            u32 const  prefix_len    = (u32)strlen(prefix);
+            u32 const  delimiter_len = (u32)strlen(delimiter);
+            bool const fold          = (snap->m_flags & env_snapshot_case_insensitive) != 0;
+
+            // the number of segments is an upper bound for the number of nodes
+            env_view_t name, value;
+            u32        capacity = 1;
+            for (uint_t i = first; i < end; ++i)
+            {
+                env_snapshot_at(snap, i, &name, null);
+                capacity += env_segment_count(name.m_str + prefix_len, name.m_len - prefix_len, delimiter, delimiter_len, fold);
+            }
+
+            // the build nodes, the index and the order of the nodes in one temporary allocation
+            env_tree_builder_t b;
+            b.m_slots = 4;
+            while (b.m_slots < capacity * 2)
+                b.m_slots <<= 1;
+            b.m_count    = 1;
+            b.m_capacity = capacity;
+            b.m_fold     = fold;
+
+            alloc_t* allocator = context_t::system_alloc();
+            b.m_nodes          = (env_tree_build_node_t*)allocator->allocate((u32)(capacity * sizeof(env_tree_build_node_t) + (b.m_slots + capacity) * sizeof(u32)));
+            check_return_val(b.m_nodes, null);
+            b.m_index = (u32*)(b.m_nodes + capacity);
+            b.m_order = b.m_index + b.m_slots;
+            memset(b.m_index, 0, b.m_slots * sizeof(u32));
+
+            // the root key is the prefix, taken from the snapshot and not from the caller's string
+            env_tree_build_node_t& root = b.m_nodes[0];
+            if (first < end)
+                env_snapshot_at(snap, first, &name, null);
+            root.m_key.m_str   = first < end ? name.m_str : "";
+            root.m_key.m_len   = first < end ? prefix_len : 0;
+            root.m_value.m_str = null;
+            root.m_value.m_len = 0;
+            root.m_hash        = 0;
+            root.m_parent      = 0;
+            root.m_child       = 0;
+            root.m_next        = 0;
+            root.m_last        = 0;
+            root.m_count       = 0;
+
+            for (uint_t i = first; i < end; ++i)
+            {
+                env_snapshot_at(snap, i, &name, &value);
+
+                // the variable that is exactly the prefix is the value of the root
+                u32         node = 0;
+                char const* str  = name.m_str + prefix_len;
+                u32         len  = name.m_len - prefix_len;
+                if (len > 0)
+                {
+                    while (true)
+                    {
+                        u32 const seg = env_segment_len(str, len, delimiter, delimiter_len, fold);
+                        node          = env_tree_child_of(&b, node, str, seg);
+                        if (seg == len)
+                            break;
+                        str += seg + delimiter_len;
+                        len -= seg + delimiter_len;
+                    }
+                }
+                b.m_nodes[node].m_value = value;
+            }
+
+            env_tree_t* tree = (env_tree_t*)allocator->allocate((u32)(sizeof(env_tree_t) + b.m_count * sizeof(env_node_t)));
+            if (!tree)
+            {
+                allocator->deallocate(b.m_nodes);
+                return null;
+            }
+            tree->m_nodes = (env_node_t*)(tree + 1);
+            tree->m_count = b.m_count;
+
+            // lay the tree out breadth first, the children of a node are next to each other and
+            // ordered by key so that env_tree_child can binary search them
+            env_node_t* nodes = tree->m_nodes;
+            u32         count = 1;
+            b.m_order[0]      = 0;
+            env_tree_node_init(&nodes[0], b.m_nodes[0], fold);
+            for (u32 n = 0; n < count; ++n)
+            {
+                env_tree_build_node_t const& from = b.m_nodes[b.m_order[n]];
+                if (from.m_count == 0)
+                    continue;
+
+                u32 const children = count;
+                for (u32 c = from.m_child; c; c = b.m_nodes[c].m_next)
+                    b.m_order[count++] = c;
+                env_tree_sort(b.m_nodes, b.m_order + children, from.m_count, fold);
+
+                for (u32 c = children; c < count; ++c)
+                {
+                    env_tree_node_init(&nodes[c], b.m_nodes[b.m_order[c]], fold);
+                    if (c + 1 < count)
+                        nodes[c].m_next = &nodes[c + 1];
+                }
+                nodes[n].m_child       = &nodes[children];
+                nodes[n].m_child_count = from.m_count;
+            }
+            ASSERT(count == b.m_count);
+
+            allocator->deallocate(b.m_nodes);
+            return tree;
+        }
+
+        void env_tree_destroy(env_tree_t* tree)
+        {
+            if (tree)
+                context_t::system_alloc()->deallocate(tree);
+        }
+
+        env_node_t const* env_tree_root(env_tree_t const* tree) { return tree ? &tree->m_nodes[0] : null; }
+
+        env_node_t const* env_tree_child(env_node_t const* node, char const* key)
+        {
+            // check
+            assert_and_check_return_val(node && key, null);
+
+            // the children are ordered by key
+            u32 const key_len = (u32)strlen(key);
+            u32       lo      = 0;
+            u32       hi      = node->m_child_count;
+            while (lo < hi)
+            {
+                u32 const mid = lo + (hi - lo) / 2;
+                s32 const c   = env_name_compare(node->m_child[mid].m_key.m_str, node->m_child[mid].m_key.m_len, key, key_len, node->m_fold);
+                if (c == 0)
+                    return &node->m_child[mid];
+                if (c < 0)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return null;
+        }
+
+    } // namespace nenv
+} // namespace ncore
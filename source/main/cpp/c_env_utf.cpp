@@ -0,0 +1,572 @@
+#include "ccore/c_target.h"
+
+#include <string.h>
+
+#if !defined(CENV_UTF_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#    define CENV_UTF_SSE2
+#    include <emmintrin.h>
+#elif !defined(CENV_UTF_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#    define CENV_UTF_NEON
+#    include <arm_neon.h>
+#endif
+
+#if defined(CENV_UTF_SSE2) && defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+#include "cenv/c_env_utf.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // ------------------------------------------------------------------------------------------
+        // kernels, each one handles whole blocks and returns how much it consumed, the scalar code
+        // takes over at the first block that does not qualify
+
+#if defined(CENV_UTF_SSE2)
+
+        static inline u32 env_utf_ctz(u32 x)
+        {
+#    if defined(_MSC_VER)
+            unsigned long r;
+            _BitScanForward(&r, x);
+            return (u32)r;
+#    else
+            return (u32)__builtin_ctz(x);
+#    endif
+        }
+
+        static inline u32 env_utf_popcount16(u32 x)
+        {
+            x = x - ((x >> 1) & 0x5555);
+            x = (x & 0x3333) + ((x >> 2) & 0x3333);
+            x = (x + (x >> 4)) & 0x0F0F;
+            return (x + (x >> 8)) & 0x1F;
+        }
+
+        // the complete sequences of a 16 byte window, the masks have one bit per byte
+        struct env_utf8_window_t
+        {
+            __m128i m_lead2; // per byte, the leads of 2, 3 and 4 byte sequences
+            __m128i m_lead3;
+            __m128i m_lead4;
+            u32     m_starts; // the first byte of every complete sequence
+            u32     m_four;   // the first byte of every complete 4 byte sequence
+            u32     m_size;   // the bytes of the complete sequences
+        };
+
+        // validate the sequences of a window that do not run past its end, false when one of them
+        // is invalid, the window starts at a sequence boundary
+        static inline bool env_utf8_window(__m128i v, env_utf8_window_t* w)
+        {
+            // as signed bytes 0x80..0xBF are -128..-65, 0xC2..0xDF are -62..-33, 0xE0..0xEF are
+            // -32..-17 and 0xF0..0xF4 are -16..-12, 0xC0, 0xC1 and 0xF5..0xFF are never valid
+            w->m_lead2         = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-63)), _mm_cmplt_epi8(v, _mm_set1_epi8(-32)));
+            w->m_lead3         = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-33)), _mm_cmplt_epi8(v, _mm_set1_epi8(-16)));
+            w->m_lead4         = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-17)), _mm_cmplt_epi8(v, _mm_set1_epi8(-11)));
+            u32 const cont     = (u32)_mm_movemask_epi8(_mm_cmplt_epi8(v, _mm_set1_epi8(-64)));
+            u32 const lead2    = (u32)_mm_movemask_epi8(w->m_lead2);
+            u32 const lead3    = (u32)_mm_movemask_epi8(w->m_lead3);
+            u32 const lead4    = (u32)_mm_movemask_epi8(w->m_lead4);
+            u32 const nonascii = (u32)_mm_movemask_epi8(v);
+
+            // the window ends before the first sequence that does not fit, the next window starts there
+            u32 const tail = (lead2 & 0x8000) | (lead3 & 0xC000) | (lead4 & 0xE000);
+            u32 const size = tail ? env_utf_ctz(tail) : 16;
+            u32 const mask = (1u << size) - 1;
+
+            // every lead is followed by exactly its continuation bytes and there are no others
+            u32 const l2       = lead2 & mask;
+            u32 const l3       = lead3 & mask;
+            u32 const l4       = lead4 & mask;
+            u32 const expected = (l2 << 1) | (l3 << 1) | (l3 << 2) | (l4 << 1) | (l4 << 2) | (l4 << 3);
+            if (expected != (cont & mask) || (nonascii & ~(cont | lead2 | lead3 | lead4) & mask) != 0)
+                return false;
+
+            // overlong 3 and 4 byte sequences, surrogates and code points above U+10FFFF
+            if (l3 | l4)
+            {
+                __m128i const n1  = _mm_srli_si128(v, 1);
+                __m128i       bad = _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xE0)), _mm_cmplt_epi8(n1, _mm_set1_epi8((char)0xA0)));
+                bad               = _mm_or_si128(bad, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xED)), _mm_cmpgt_epi8(n1, _mm_set1_epi8((char)0x9F))));
+                bad               = _mm_or_si128(bad, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xF0)), _mm_cmplt_epi8(n1, _mm_set1_epi8((char)0x90))));
+                bad               = _mm_or_si128(bad, _mm_and_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)0xF4)), _mm_cmpgt_epi8(n1, _mm_set1_epi8((char)0x8F))));
+                if (((u32)_mm_movemask_epi8(bad) & mask) != 0)
+                    return false;
+            }
+
+            w->m_starts = ~cont & mask;
+            w->m_four   = l4;
+            w->m_size   = size;
+            return true;
+        }
+
+        // the utf-16 units of 8 byte positions, as if a sequence starts at every one of them, b1..b3
+        // are the bytes that follow, the low surrogate of a 4 byte sequence is returned in lo
+        static inline __m128i env_utf8_window_units(__m128i b0, __m128i b1, __m128i b2, __m128i b3, __m128i m2, __m128i m3, __m128i m4, __m128i* lo)
+        {
+            __m128i const m3f = _mm_set1_epi16(0x3F);
+            __m128i const c1  = _mm_and_si128(b1, m3f);
+            __m128i const c2  = _mm_and_si128(b2, m3f);
+            __m128i const c3  = _mm_and_si128(b3, m3f);
+
+            // the shift by 12 drops the lead bits of a 3 byte sequence, 0xD7C0 is 0xD800 - (0x10000 >> 10)
+            __m128i const u2 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(b0, _mm_set1_epi16(0x1F)), 6), c1);
+            __m128i const u3 = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(b0, 12), _mm_slli_epi16(c1, 6)), c2);
+            __m128i const u4 = _mm_add_epi16(_mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(b0, _mm_set1_epi16(0x07)), 8), _mm_slli_epi16(c1, 2)), _mm_srli_epi16(c2, 4)), _mm_set1_epi16((short)0xD7C0));
+            *lo              = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_and_si128(c2, _mm_set1_epi16(0x0F)), 6), c3), _mm_set1_epi16((short)0xDC00));
+
+            __m128i u = _mm_andnot_si128(_mm_or_si128(_mm_or_si128(m2, m3), m4), b0);
+            u         = _mm_or_si128(u, _mm_and_si128(m2, u2));
+            u         = _mm_or_si128(u, _mm_and_si128(m3, u3));
+            return _mm_or_si128(u, _mm_and_si128(m4, u4));
+        }
+
+        // count the utf-16 units of the valid windows at the start of src
+        static uint_t env_utf8_count_blocks(u8 const* src, uint_t len, uint_t* units)
+        {
+            uint_t i = 0;
+            uint_t n = 0;
+            while (i + 16 <= len)
+            {
+                __m128i const v = _mm_loadu_si128((__m128i const*)(src + i));
+                if (_mm_movemask_epi8(v) == 0)
+                {
+                    i += 16;
+                    n += 16;
+                    continue;
+                }
+
+                env_utf8_window_t w;
+                if (!env_utf8_window(v, &w))
+                    break;
+                i += w.m_size;
+                n += env_utf_popcount16(w.m_starts) + env_utf_popcount16(w.m_four);
+            }
+            *units = n;
+            return i;
+        }
+
+        // convert the valid windows at the start of src
+        //
+        // the units of every byte position are computed at once and the ones that start a
+        // sequence are moved together a run at a time, the low surrogate of a 4 byte sequence
+        // takes the place of its second byte. the runs are stored 16 units at a time, directly
+        // into dst while at least 48 more bytes follow, which is room for 16 more units.
+        static uint_t env_utf8_widen_blocks(u8 const* src, uint_t len, u16* dst, uint_t* units)
+        {
+            __m128i const zero = _mm_setzero_si128();
+            uint_t        i    = 0;
+            u16*          out  = dst;
+            while (i + 16 <= len)
+            {
+                __m128i const v = _mm_loadu_si128((__m128i const*)(src + i));
+                if (_mm_movemask_epi8(v) == 0)
+                {
+                    _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(v, zero));
+                    _mm_storeu_si128((__m128i*)(out + 8), _mm_unpackhi_epi8(v, zero));
+                    i += 16;
+                    out += 16;
+                    continue;
+                }
+
+                env_utf8_window_t w;
+                if (!env_utf8_window(v, &w))
+                    break;
+
+                __m128i const n1 = _mm_srli_si128(v, 1);
+                __m128i const n2 = _mm_srli_si128(v, 2);
+                __m128i const n3 = _mm_srli_si128(v, 3);
+                __m128i const m4l = _mm_unpacklo_epi8(w.m_lead4, w.m_lead4);
+                __m128i const m4h = _mm_unpackhi_epi8(w.m_lead4, w.m_lead4);
+                __m128i       lol, loh;
+                __m128i       ul  = env_utf8_window_units(_mm_unpacklo_epi8(v, zero), _mm_unpacklo_epi8(n1, zero), _mm_unpacklo_epi8(n2, zero), _mm_unpacklo_epi8(n3, zero), _mm_unpacklo_epi8(w.m_lead2, w.m_lead2),
+                                                          _mm_unpacklo_epi8(w.m_lead3, w.m_lead3), m4l, &lol);
+                __m128i       uh  = env_utf8_window_units(_mm_unpackhi_epi8(v, zero), _mm_unpackhi_epi8(n1, zero), _mm_unpackhi_epi8(n2, zero), _mm_unpackhi_epi8(n3, zero), _mm_unpackhi_epi8(w.m_lead2, w.m_lead2),
+                                                          _mm_unpackhi_epi8(w.m_lead3, w.m_lead3), m4h, &loh);
+
+                // the low surrogates move one lane up, onto the first continuation byte
+                if (w.m_four)
+                {
+                    __m128i const sl = _mm_slli_si128(lol, 2);
+                    __m128i const sh = _mm_or_si128(_mm_slli_si128(loh, 2), _mm_srli_si128(lol, 14));
+                    __m128i const ml = _mm_slli_si128(m4l, 2);
+                    __m128i const mh = _mm_or_si128(_mm_slli_si128(m4h, 2), _mm_srli_si128(m4l, 14));
+                    ul               = _mm_or_si128(_mm_andnot_si128(ml, ul), _mm_and_si128(ml, sl));
+                    uh               = _mm_or_si128(_mm_andnot_si128(mh, uh), _mm_and_si128(mh, sh));
+                }
+
+                // the lanes past 16 are read by the last run and never kept
+                u16 lanes[32];
+                _mm_storeu_si128((__m128i*)lanes, ul);
+                _mm_storeu_si128((__m128i*)(lanes + 8), uh);
+                _mm_storeu_si128((__m128i*)(lanes + 16), zero);
+                _mm_storeu_si128((__m128i*)(lanes + 24), zero);
+
+                u16  stage[32];
+                bool room = i + 16 + 48 <= len;
+                u16* to   = room ? out : stage;
+                u16* at   = to;
+                for (u32 keep = w.m_starts | (w.m_four << 1); keep;)
+                {
+                    u32 const first = env_utf_ctz(keep);
+                    u32 const run   = env_utf_ctz(~(keep >> first));
+                    _mm_storeu_si128((__m128i*)at, _mm_loadu_si128((__m128i const*)(lanes + first)));
+                    _mm_storeu_si128((__m128i*)(at + 8), _mm_loadu_si128((__m128i const*)(lanes + first + 8)));
+                    at += run;
+                    keep &= ~(((1u << run) - 1) << first);
+                }
+                if (!room)
+                {
+                    for (u16 const* p = stage; p < at; ++p)
+                        *out++ = *p;
+                }
+                else
+                    out = at;
+                i += w.m_size;
+            }
+            *units = (uint_t)(out - dst);
+            return i;
+        }
+
+#else
+
+        // the length of the ascii run at the start of src, in whole blocks
+        static uint_t env_utf8_count_blocks(u8 const* src, uint_t len, uint_t* units)
+        {
+            uint_t i = 0;
+#    if defined(CENV_UTF_NEON)
+            for (; i + 16 <= len; i += 16)
+            {
+                if (vmaxvq_u8(vld1q_u8(src + i)) >= 0x80)
+                    break;
+            }
+#    endif
+            for (; i + 8 <= len; i += 8)
+            {
+                u64 w;
+                memcpy(&w, src + i, 8);
+                if (w & 0x8080808080808080ull)
+                    break;
+            }
+            *units = i;
+            return i;
+        }
+
+        // widen the ascii run at the start of src, in whole blocks
+        static uint_t env_utf8_widen_blocks(u8 const* src, uint_t len, u16* dst, uint_t* units)
+        {
+            uint_t i = 0;
+#    if defined(CENV_UTF_NEON)
+            for (; i + 16 <= len; i += 16)
+            {
+                uint8x16_t const v = vld1q_u8(src + i);
+                if (vmaxvq_u8(v) >= 0x80)
+                    break;
+                vst1q_u16(dst + i, vmovl_u8(vget_low_u8(v)));
+                vst1q_u16(dst + i + 8, vmovl_u8(vget_high_u8(v)));
+            }
+#    endif
+            for (; i + 8 <= len; i += 8)
+            {
+                u64 w;
+                memcpy(&w, src + i, 8);
+                if (w & 0x8080808080808080ull)
+                    break;
+                for (uint_t j = 0; j < 8; ++j)
+                    dst[i + j] = src[i + j];
+            }
+            *units = i;
+            return i;
+        }
+
+#endif
+
+        // count the utf-8 bytes of the blocks at the start of src that hold no surrogates
+        static uint_t env_utf16_count_bmp(u16 const* src, uint_t len, uint_t* bytes)
+        {
+            uint_t i = 0;
+            uint_t n = 0;
+#if defined(CENV_UTF_SSE2)
+            __m128i const zero  = _mm_setzero_si128();
+            __m128i const ones  = _mm_set1_epi16(1);
+            __m128i const m7f   = _mm_set1_epi16(0x7F);
+            __m128i const m7ff  = _mm_set1_epi16(0x7FF);
+            __m128i const mf800 = _mm_set1_epi16((short)0xF800);
+            __m128i const md800 = _mm_set1_epi16((short)0xD800);
+            while (i + 8 <= len)
+            {
+                // every unit counts as 3 bytes, a lane below 0x80 or below 0x800 subtracts 1 from
+                // its 16 bit counter, which is folded into n before it can wrap around
+                __m128i acc    = zero;
+                uint_t  blocks = 0;
+                for (; i + 8 <= len && blocks < 16384; i += 8, ++blocks)
+                {
+                    __m128i const v = _mm_loadu_si128((__m128i const*)(src + i));
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mf800), md800)) != 0)
+                        break;
+
+                    // a lane that saturates to zero is below the threshold
+                    acc = _mm_add_epi16(acc, _mm_cmpeq_epi16(_mm_subs_epu16(v, m7f), zero));
+                    acc = _mm_add_epi16(acc, _mm_cmpeq_epi16(_mm_subs_epu16(v, m7ff), zero));
+                }
+
+                __m128i sum = _mm_madd_epi16(acc, ones);
+                sum         = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+                sum         = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+                n += (uint_t)((s64)blocks * 24 + _mm_cvtsi128_si32(sum));
+                if (blocks < 16384)
+                    break;
+            }
+#elif defined(CENV_UTF_NEON)
+            uint16x8_t const m80   = vdupq_n_u16(0x80);
+            uint16x8_t const m800  = vdupq_n_u16(0x800);
+            uint16x8_t const mf800 = vdupq_n_u16(0xF800);
+            uint16x8_t const md800 = vdupq_n_u16(0xD800);
+            for (; i + 8 <= len; i += 8)
+            {
+                uint16x8_t const v = vld1q_u16(src + i);
+                if (vmaxvq_u16(vceqq_u16(vandq_u16(v, mf800), md800)) != 0)
+                    break;
+                n += 8 + vaddvq_u16(vshrq_n_u16(vcgeq_u16(v, m80), 15)) + vaddvq_u16(vshrq_n_u16(vcgeq_u16(v, m800), 15));
+            }
+#else
+            for (; i + 4 <= len; i += 4)
+            {
+                u64 w;
+                memcpy(&w, src + i, 8);
+                if (w & 0xFF80FF80FF80FF80ull)
+                    break;
+                n += 4;
+            }
+#endif
+            *bytes = n;
+            return i;
+        }
+
+        // narrow the ascii run at the start of src, in whole blocks
+        static uint_t env_utf16_narrow_ascii(u16 const* src, uint_t len, u8* dst)
+        {
+            uint_t i = 0;
+#if defined(CENV_UTF_SSE2)
+            __m128i const zero = _mm_setzero_si128();
+            __m128i const m7f  = _mm_set1_epi16(0x7F);
+            for (; i + 8 <= len; i += 8)
+            {
+                __m128i const v = _mm_loadu_si128((__m128i const*)(src + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_subs_epu16(v, m7f), zero)) != 0xFFFF)
+                    return i;
+                _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(v, v));
+            }
+#elif defined(CENV_UTF_NEON)
+            for (; i + 8 <= len; i += 8)
+            {
+                uint16x8_t const v = vld1q_u16(src + i);
+                if (vmaxvq_u16(v) >= 0x80)
+                    return i;
+                vst1_u8(dst + i, vmovn_u16(v));
+            }
+#else
+            for (; i + 4 <= len; i += 4)
+            {
+                u64 w;
+                memcpy(&w, src + i, 8);
+                if (w & 0xFF80FF80FF80FF80ull)
+                    return i;
+                for (uint_t j = 0; j < 4; ++j)
+                    dst[i + j] = (u8)src[i + j];
+            }
+#endif
+            return i;
+        }
+
+        // ------------------------------------------------------------------------------------------
+        // scalar code
+
+        // decode one non-ascii utf-8 sequence, returns its length in bytes or 0 when invalid
+        static uint_t env_utf8_decode(u8 const* src, uint_t len, u32* cp)
+        {
+            u8 const c = src[0];
+            if (c < 0xC2)
+                return 0;
+            if (c < 0xE0)
+            {
+                if (len < 2 || (src[1] & 0xC0) != 0x80)
+                    return 0;
+                *cp = ((u32)(c & 0x1F) << 6) | (src[1] & 0x3F);
+                return 2;
+            }
+            if (c < 0xF0)
+            {
+                if (len < 3 || (src[1] & 0xC0) != 0x80 || (src[2] & 0xC0) != 0x80)
+                    return 0;
+                // overlong or a surrogate
+                if ((c == 0xE0 && src[1] < 0xA0) || (c == 0xED && src[1] >= 0xA0))
+                    return 0;
+                *cp = ((u32)(c & 0x0F) << 12) | ((u32)(src[1] & 0x3F) << 6) | (src[2] & 0x3F);
+                return 3;
+            }
+            if (c < 0xF5)
+            {
+                if (len < 4 || (src[1] & 0xC0) != 0x80 || (src[2] & 0xC0) != 0x80 || (src[3] & 0xC0) != 0x80)
+                    return 0;
+                // overlong or above U+10FFFF
+                if ((c == 0xF0 && src[1] < 0x90) || (c == 0xF4 && src[1] >= 0x90))
+                    return 0;
+                *cp = ((u32)(c & 0x07) << 18) | ((u32)(src[1] & 0x3F) << 12) | ((u32)(src[2] & 0x3F) << 6) | (src[3] & 0x3F);
+                return 4;
+            }
+            return 0;
+        }
+
+        uint_t env_utf8_to_utf16_len(char const* str, uint_t len)
+        {
+            u8 const* src = (u8 const*)str;
+            uint_t    i   = 0;
+            uint_t    n   = 0;
+            while (i < len)
+            {
+                // whole blocks, the scalar code takes the one sequence that stopped them
+                uint_t units = 0;
+                i += env_utf8_count_blocks(src + i, len - i, &units);
+                n += units;
+                if (i >= len)
+                    break;
+
+                if (src[i] < 0x80)
+                {
+                    i++;
+                    n++;
+                    continue;
+                }
+
+                u32          cp;
+                uint_t const size = env_utf8_decode(src + i, len - i, &cp);
+                if (size == 0)
+                    return env_utf_invalid;
+                i += size;
+                n += size == 4 ? 2 : 1;
+            }
+            return n;
+        }
+
+        uint_t env_utf8_to_utf16(char const* str, uint_t len, u16* dst)
+        {
+            u8 const* src = (u8 const*)str;
+            u16*      out = dst;
+            uint_t    i   = 0;
+            while (i < len)
+            {
+                uint_t units = 0;
+                i += env_utf8_widen_blocks(src + i, len - i, out, &units);
+                out += units;
+                if (i >= len)
+                    break;
+
+                if (src[i] < 0x80)
+                {
+                    *out++ = src[i++];
+                    continue;
+                }
+
+                u32          cp   = 0;
+                uint_t const size = env_utf8_decode(src + i, len - i, &cp);
+                if (size == 0)
+                    return env_utf_invalid;
+                i += size;
+                if (cp >= 0x10000)
+                {
+                    cp -= 0x10000;
+                    *out++ = (u16)(0xD800 | (cp >> 10));
+                    *out++ = (u16)(0xDC00 | (cp & 0x3FF));
+                }
+                else
+                {
+                    *out++ = (u16)cp;
+                }
+            }
+            return (uint_t)(out - dst);
+        }
+
+        uint_t env_utf16_to_utf8_len(u16 const* src, uint_t len)
+        {
+            uint_t i = 0;
+            uint_t n = 0;
+            while (i < len)
+            {
+                uint_t bytes = 0;
+                i += env_utf16_count_bmp(src + i, len - i, &bytes);
+                n += bytes;
+                if (i >= len)
+                    break;
+
+                u16 const c = src[i];
+                if (c < 0x80)
+                    n += 1;
+                else if (c < 0x800)
+                    n += 2;
+                else if (c < 0xD800 || c > 0xDFFF)
+                    n += 3;
+                else if (c <= 0xDBFF && i + 1 < len && src[i + 1] >= 0xDC00 && src[i + 1] <= 0xDFFF)
+                {
+                    n += 4;
+                    i++;
+                }
+                else
+                    return env_utf_invalid;
+                i++;
+            }
+            return n;
+        }
+
+        uint_t env_utf16_to_utf8(u16 const* src, uint_t len, char* str)
+        {
+            u8*    dst = (u8*)str;
+            u8*    out = dst;
+            uint_t i   = 0;
+            while (i < len)
+            {
+                if (src[i] < 0x80)
+                {
+                    if (i + 1 < len && src[i + 1] >= 0x80)
+                    {
+                        *out++ = (u8)src[i++];
+                        continue;
+                    }
+
+                    uint_t const run = env_utf16_narrow_ascii(src + i, len - i, out);
+                    i += run;
+                    out += run;
+                    while (i < len && src[i] < 0x80)
+                        *out++ = (u8)src[i++];
+                    continue;
+                }
+
+                u32 cp = src[i++];
+                if (cp < 0x800)
+                {
+                    *out++ = (u8)(0xC0 | (cp >> 6));
+                    *out++ = (u8)(0x80 | (cp & 0x3F));
+                }
+                else if (cp < 0xD800 || cp > 0xDFFF)
+                {
+                    *out++ = (u8)(0xE0 | (cp >> 12));
+                    *out++ = (u8)(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = (u8)(0x80 | (cp & 0x3F));
+                }
+                else
+                {
+                    ASSERT(i < len);
+                    cp     = 0x10000 + (((cp & 0x3FF) << 10) | (src[i++] & 0x3FF));
+                    *out++ = (u8)(0xF0 | (cp >> 18));
+                    *out++ = (u8)(0x80 | ((cp >> 12) & 0x3F));
+                    *out++ = (u8)(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = (u8)(0x80 | (cp & 0x3F));
+                }
+            }
+            return (uint_t)(out - dst);
+        }
+
+    } // namespace nenv
+} // namespace ncore
@@ -0,0 +1,418 @@
+#include "ccore/c_target.h"
+
+#include <string.h>
+
+#include "cbase/c_context.h"
+#include "cenv/c_env_watch.h"
+#include "cenv/private/c_assert.h"
+#include "cenv/private/c_env_hooks.h"
+#include "cenv/private/c_env_snapshot_layout.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // a change that has not been delivered yet, name and old value share one allocation
+        struct env_pending_t
+        {
+            char*       m_name;
+            char const* m_old; // null when the variable did not exist
+            u32         m_name_len;
+            u32         m_hash;
+        };
+
+        struct env_watch_t
+        {
+            env_watch_t*     m_next;
+            char*            m_key;
+            u32              m_key_len;
+            bool             m_prefix;
+            bool             m_dead;
+            env_watch_mode_t m_mode;
+            env_watch_fn     m_fn;
+            void*            m_user;
+            env_pending_t*   m_pending;
+            u32*             m_index; // pending index + 1, 0 is empty, shares the allocation of m_pending
+            u32              m_count;
+            u32              m_capacity;
+            u32              m_slots;
+        };
+
+        static env_watch_t* s_watches     = null;
+        static s32          s_batch       = 0;
+        static s32          s_dispatching = 0;
+        static u32          s_pending     = 0; // pending changes of sync subscribers
+
+        // the filter, the hashes of every key and the distinct lengths of the prefix keys
+        static u32* s_filter       = null;
+        static u32  s_filter_slots = 0;
+        static u32* s_lengths      = null;
+        static u32  s_length_count = 0;
+
+        // names are case-insensitive on windows, the filter and the keys fold there
+        static inline u32 env_filter_hash(char const* key, uint_t len)
+        {
+            u32 const hash = env_hash_name_native(key, len);
+            return hash ? hash : 1;
+        }
+
+        static bool env_filter_has(u32 hash)
+        {
+            u32 const mask = s_filter_slots - 1;
+            for (u32 slot = hash & mask;; slot = (slot + 1) & mask)
+            {
+                if (s_filter[slot] == hash)
+                    return true;
+                if (s_filter[slot] == 0)
+                    return false;
+            }
+        }
+
+        static void env_filter_rebuild()
+        {
+            alloc_t* allocator = context_t::system_alloc();
+            if (s_filter)
+                allocator->deallocate(s_filter);
+            if (s_lengths)
+                allocator->deallocate(s_lengths);
+            s_filter       = null;
+            s_filter_slots = 0;
+            s_lengths      = null;
+            s_length_count = 0;
+
+            u32 count = 0;
+            for (env_watch_t* w = s_watches; w; w = w->m_next)
+                count++;
+            if (count == 0)
+                return;
+
+            u32 slots = 8;
+            while (slots < count * 2)
+                slots <<= 1;
+            s_filter  = (u32*)allocator->allocate(slots * sizeof(u32));
+            s_lengths = (u32*)allocator->allocate(count * sizeof(u32));
+            ASSERT(s_filter && s_lengths);
+            s_filter_slots = slots;
+            memset(s_filter, 0, slots * sizeof(u32));
+
+            for (env_watch_t* w = s_watches; w; w = w->m_next)
+            {
+                u32 const hash = env_filter_hash(w->m_key, w->m_key_len);
+                u32       slot = hash & (slots - 1);
+                while (s_filter[slot] != 0 && s_filter[slot] != hash)
+                    slot = (slot + 1) & (slots - 1);
+                s_filter[slot] = hash;
+
+                if (!w->m_prefix)
+                    continue;
+
+                // the prefix lengths are kept sorted and unique
+                u32 i = 0;
+                while (i < s_length_count && s_lengths[i] < w->m_key_len)
+                    i++;
+                if (i < s_length_count && s_lengths[i] == w->m_key_len)
+                    continue;
+                memmove(s_lengths + i + 1, s_lengths + i, (s_length_count - i) * sizeof(u32));
+                s_lengths[i] = w->m_key_len;
+                s_length_count++;
+            }
+        }
+
+        // can a subscriber be interested in this name, false is always right
+        static bool env_filter_match(char const* name, u32 len, u32 hash)
+        {
+            if (env_filter_has(hash))
+                return true;
+            for (u32 i = 0; i < s_length_count && s_lengths[i] < len; ++i)
+            {
+                if (env_filter_has(env_filter_hash(name, s_lengths[i])))
+                    return true;
+            }
+            return false;
+        }
+
+        static inline bool env_watch_matches(env_watch_t const* w, char const* name, u32 len)
+        {
+            if (w->m_prefix ? len < w->m_key_len : len != w->m_key_len)
+                return false;
+            return env_name_equal_native(name, w->m_key, w->m_key_len);
+        }
+
+        static env_pending_t const* env_pending_find(env_watch_t const* w, char const* name, u32 len, u32 hash)
+        {
+            if (w->m_slots == 0)
+                return null;
+
+            u32 const mask = w->m_slots - 1;
+            for (u32 slot = hash & mask;; slot = (slot + 1) & mask)
+            {
+                u32 const i = w->m_index[slot];
+                if (i == 0)
+                    return null;
+                env_pending_t const& p = w->m_pending[i - 1];
+                if (p.m_hash == hash && p.m_name_len == len && env_name_equal_native(p.m_name, name, len))
+                    return &p;
+            }
+        }
+
+        static bool env_pending_grow(env_watch_t* w)
+        {
+            // the pending changes and their index in one allocation
+            alloc_t*       allocator = context_t::system_alloc();
+            u32 const      capacity  = w->m_capacity ? w->m_capacity * 2 : 4;
+            u32 const      slots     = capacity * 2;
+            env_pending_t* pending   = (env_pending_t*)allocator->allocate(capacity * sizeof(env_pending_t) + slots * sizeof(u32));
+            check_return_val(pending, false);
+
+            if (w->m_count)
+                memcpy(pending, w->m_pending, w->m_count * sizeof(env_pending_t));
+
+            // rehash
+            u32* index = (u32*)(pending + capacity);
+            memset(index, 0, slots * sizeof(u32));
+            for (u32 i = 0; i < w->m_count; ++i)
+            {
+                u32 slot = pending[i].m_hash & (slots - 1);
+                while (index[slot] != 0)
+                    slot = (slot + 1) & (slots - 1);
+                index[slot] = i + 1;
+            }
+
+            if (w->m_pending)
+                allocator->deallocate(w->m_pending);
+            w->m_pending  = pending;
+            w->m_index    = index;
+            w->m_capacity = capacity;
+            w->m_slots    = slots;
+            return true;
+        }
+
+        static void env_pending_free(env_pending_t* pending, u32 count)
+        {
+            alloc_t* allocator = context_t::system_alloc();
+            for (u32 i = 0; i < count; ++i)
+                allocator->deallocate(pending[i].m_name);
+            if (pending)
+                allocator->deallocate(pending);
+        }
+
+        env_watch_t* env_watch(char const* key, bool prefix, env_watch_mode_t mode, env_watch_fn fn, void* user)
+        {
+            // check
+            assert_and_check_return_val(key && fn, null);
+
+            alloc_t*     allocator = context_t::system_alloc();
+            u32 const    len       = (u32)strlen(key);
+            env_watch_t* w         = (env_watch_t*)allocator->allocate(sizeof(env_watch_t) + len + 1);
+            check_return_val(w, null);
+
+            w->m_key = (char*)(w + 1);
+            memcpy(w->m_key, key, len + 1);
+            w->m_key_len  = len;
+            w->m_prefix   = prefix;
+            w->m_dead     = false;
+            w->m_mode     = mode;
+            w->m_fn       = fn;
+            w->m_user     = user;
+            w->m_pending  = null;
+            w->m_index    = null;
+            w->m_count    = 0;
+            w->m_capacity = 0;
+            w->m_slots    = 0;
+            w->m_next     = s_watches;
+            s_watches     = w;
+
+            env_filter_rebuild();
+            return w;
+        }
+
+        static void env_watch_remove_dead()
+        {
+            env_watch_t** link = &s_watches;
+            while (*link)
+            {
+                env_watch_t* w = *link;
+                if (!w->m_dead)
+                {
+                    link = &w->m_next;
+                    continue;
+                }
+                *link = w->m_next;
+                env_pending_free(w->m_pending, w->m_count);
+                context_t::system_alloc()->deallocate(w);
+            }
+            env_filter_rebuild();
+        }
+
+        void env_unwatch(env_watch_t* watch)
+        {
+            if (!watch)
+                return;
+            if (watch->m_mode == env_watch_sync)
+                s_pending -= watch->m_count;
+            watch->m_dead = true;
+
+            // a callback may unsubscribe, the list is cleaned up after the dispatch
+            if (s_dispatching == 0)
+                env_watch_remove_dead();
+        }
+
+        void env_watch_before(char const* name)
+        {
+            // nobody is watching
+            if (!s_filter)
+                return;
+
+            u32 const len  = (u32)strlen(name);
+            u32 const hash = env_filter_hash(name, len);
+            if (!env_filter_match(name, len, hash))
+                return;
+
+            for (env_watch_t* w = s_watches; w; w = w->m_next)
+            {
+                if (w->m_dead || !env_watch_matches(w, name, len))
+                    continue;
+
+                // coalesce, the first old value is the one that counts
+                if (env_pending_find(w, name, len, hash))
+                    continue;
+                if (w->m_count == w->m_capacity && !env_pending_grow(w))
+                    continue;
+
+                // "name\0old\0"
+                uint_t      size  = 0;
+                char const* value = env_native_acquire(name, &size);
+                char*       copy  = (char*)context_t::system_alloc()->allocate((u32)(len + 1 + (value ? size + 1 : 0)), 1);
+                if (copy)
+                {
+                    memcpy(copy, name, len + 1);
+                    if (value)
+                        memcpy(copy + len + 1, value, size + 1);
+
+                    env_pending_t& p = w->m_pending[w->m_count++];
+                    p.m_name         = copy;
+                    p.m_old          = value ? copy + len + 1 : null;
+                    p.m_name_len     = len;
+                    p.m_hash         = hash;
+
+                    u32 slot = hash & (w->m_slots - 1);
+                    while (w->m_index[slot] != 0)
+                        slot = (slot + 1) & (w->m_slots - 1);
+                    w->m_index[slot] = w->m_count;
+                    if (w->m_mode == env_watch_sync)
+                        s_pending++;
+                }
+                env_native_release(value);
+            }
+        }
+
+        // deliver the pending changes of one subscriber, returns true when the callback was made
+        static bool env_watch_deliver(env_watch_t* w)
+        {
+            // detach the pending changes, the callback may cause new ones
+            env_pending_t* pending = w->m_pending;
+            u32 const      count   = w->m_count;
+            w->m_pending           = null;
+            w->m_index             = null;
+            w->m_count             = 0;
+            w->m_capacity          = 0;
+            w->m_slots             = 0;
+            if (w->m_mode == env_watch_sync)
+                s_pending -= count;
+
+            alloc_t*      allocator = context_t::system_alloc();
+            env_change_t* changes   = (env_change_t*)allocator->allocate(count * sizeof(env_change_t));
+            u32           n         = 0;
+            for (u32 i = 0; changes && i < count; ++i)
+            {
+                env_pending_t const& p = pending[i];
+
+                // drop the variables that are back at their old value
+                uint_t      size    = 0;
+                char const* current = env_native_acquire(p.m_name, &size);
+                bool const  same    = p.m_old ? (current && strcmp(current, p.m_old) == 0) : (current == null);
+                if (same)
+                {
+                    env_native_release(current);
+                    continue;
+                }
+
+                env_change_t& c = changes[n++];
+                c.m_name.m_str  = p.m_name;
+                c.m_name.m_len  = p.m_name_len;
+                c.m_old.m_str   = p.m_old;
+                c.m_old.m_len   = p.m_old ? (u32)strlen(p.m_old) : 0;
+                c.m_new.m_str   = current;
+                c.m_new.m_len   = current ? (u32)size : 0;
+            }
+
+            if (n > 0)
+                w->m_fn(w->m_user, changes, n);
+
+            for (u32 i = 0; i < n; ++i)
+                env_native_release(changes[i].m_new.m_str);
+            if (changes)
+                allocator->deallocate(changes);
+            env_pending_free(pending, count);
+            return n > 0;
+        }
+
+        static uint_t env_watch_flush(bool deferred)
+        {
+            // a callback that changes a watched variable causes another round, bounded so
+            // that two subscribers cannot keep each other busy forever
+            uint_t calls = 0;
+            s_dispatching++;
+            for (s32 round = 0; round < 8; ++round)
+            {
+                bool busy = false;
+                for (env_watch_t* w = s_watches; w; w = w->m_next)
+                {
+                    if (w->m_dead || w->m_count == 0)
+                        continue;
+                    if (w->m_mode == env_watch_deferred && !deferred)
+                        continue;
+                    busy = true;
+                    if (env_watch_deliver(w))
+                        calls++;
+                }
+                if (!busy)
+                    break;
+            }
+            s_dispatching--;
+
+            if (s_dispatching == 0)
+            {
+                bool dead = false;
+                for (env_watch_t* w = s_watches; w && !dead; w = w->m_next)
+                    dead = w->m_dead;
+                if (dead)
+                    env_watch_remove_dead();
+            }
+            return calls;
+        }
+
+        void env_watch_after(char const*)
+        {
+            if (s_pending == 0 || s_batch > 0 || s_dispatching > 0)
+                return;
+            env_watch_flush(false);
+        }
+
+        void env_batch_begin(void) { s_batch++; }
+
+        void env_batch_end(void)
+        {
+            ASSERT(s_batch > 0);
+            if (s_batch > 0 && --s_batch == 0 && s_pending > 0 && s_dispatching == 0)
+                env_watch_flush(false);
+        }
+
+        uint_t env_watch_pump(void)
+        {
+            check_return_val(s_dispatching == 0, 0);
+            return env_watch_flush(true);
+        }
+
+    } // namespace nenv
+} // namespace ncore
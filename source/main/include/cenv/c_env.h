@@ -9,7 +9,7 @@
 
 namespace ncore
 {
-    namespace xenv
+    namespace nenv
     {
         struct env_t;
         typedef env_t* penv_t;                
@@ -197,7 +197,7 @@ namespace ncore
 
         // set the env variable values
         //
-        // we will set all values and overwrite it
+        // we will set all values and overwrite it, we will remove this env variable if values is null
         //
         // @param name          the variable name
         // @param values        the variable values, separator: windows(';') or other(';')
@@ -224,7 +224,7 @@ namespace ncore
         //
         bool env_remove(char const* name);
 
-    } // namespace xenv
+    } // namespace nenv
 
 } // namespace ncore
 
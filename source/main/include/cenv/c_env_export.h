@@ -0,0 +1,66 @@
+#ifndef __CENV_ENV_EXPORT_H__
+#define __CENV_ENV_EXPORT_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "cenv/c_env_snapshot.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // write an environment to a file descriptor
+        //
+        // nothing is concatenated, the output is gathered with writev from iovecs that point
+        // straight at the names and values, quotes and escapes point at constant strings.
+        // an environment that needs more than IOV_MAX iovecs is written in several calls.
+        //
+        // writing to a pipe or a socket whose reader has exited raises SIGPIPE, which kills the
+        // process by default. callers that export to a helper that may exit early must ignore or
+        // block SIGPIPE, the export then fails with EPIPE and returns false.
+        //
+        // only available on TARGET_LINUX and TARGET_MAC.
+        //
+        enum env_export_format_t
+        {
+            env_export_block  = 0, // NAME=VALUE\0, the format of /proc/<pid>/environ and execve
+            env_export_dotenv = 1, // NAME="VALUE"\n, with \\ \" \$ \` \n and \r escaped
+            env_export_shell  = 2, // export NAME='VALUE'\n, names that are not a shell identifier are skipped
+        };
+
+        // export the environment of the current process
+        //
+        // @param fd            the file descriptor, a file, a pipe or a socket
+        // @param format        the format
+        //
+        // @return              true or false
+        //
+        bool env_export_live(int fd, env_export_format_t format);
+
+        // export a snapshot
+        //
+        // @code
+        //
+        //            int fds[2];
+        //            pipe(fds);
+        //            // ... fork the helper that reads fds[0]
+        //            env_export_snapshot(fds[1], snap, env_export_block);
+        //            close(fds[1]);
+        //
+        // @endcode
+        //
+        // @param fd            the file descriptor, a file, a pipe or a socket
+        // @param snap          the snapshot
+        // @param format        the format
+        //
+        // @return              true or false
+        //
+        bool env_export_snapshot(int fd, env_snapshot_t const* snap, env_export_format_t format);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_EXPORT_H__
@@ -0,0 +1,96 @@
+#ifndef __CENV_ENV_FINGERPRINT_H__
+#define __CENV_ENV_FINGERPRINT_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // a 128-bit fingerprint of the environment or of a set of variables
+        //
+        // every variable is hashed on its own (name and value, wyhash style) and the hashes
+        // are added per 64-bit lane, so the fingerprint does not depend on the order of the
+        // variables and a change is applied by subtracting the old hash and adding the new one.
+        // a variable that does not exist adds nothing. names are compared case-insensitive on
+        // TARGET_OS_WINDOWS, like the environment itself.
+        //
+        // use m_lo alone when 64 bits are enough.
+        //
+        struct env_fingerprint_t
+        {
+            u64 m_lo;
+            u64 m_hi;
+        };
+
+        inline bool operator==(env_fingerprint_t const& a, env_fingerprint_t const& b) { return a.m_lo == b.m_lo && a.m_hi == b.m_hi; }
+        inline bool operator!=(env_fingerprint_t const& a, env_fingerprint_t const& b) { return !(a == b); }
+
+        // a fingerprint that is kept up to date by the mutators of c_env.h
+        struct env_tracker_t;
+
+        // compute a fingerprint from scratch
+        //
+        // @param names         the variable names, null for the whole environment
+        // @param count         the number of names
+        // @param fp            the fingerprint
+        //
+        // @return              true or false
+        //
+        bool env_fingerprint(char const* const* names, uint_t count, env_fingerprint_t* fp);
+
+        // start tracking the fingerprint of the environment or of a set of variables
+        //
+        // env_set, env_add, env_save, env_remove and guard rollbacks update the tracked
+        // fingerprints with the hashes of the one variable they change, changes that are made
+        // behind the back of this library (setenv, putenv, a child library) are not seen,
+        // call env_tracker_reset after those.
+        //
+        // @code
+        //
+        //            char const*    names[] = {"CC", "CFLAGS", "PATH", "SDKROOT"};
+        //            env_tracker_t* tracker = env_tracker_create(names, 4);
+        //            ...
+        //            env_fingerprint_t key = env_tracker_fingerprint(tracker);    // O(1)
+        //            ...
+        //            env_tracker_destroy(tracker);
+        //
+        // @endcode
+        //
+        // @param names         the variable names, null for the whole environment, copied
+        // @param count         the number of names
+        //
+        // @return              the tracker
+        //
+        env_tracker_t* env_tracker_create(char const* const* names, uint_t count);
+
+        // stop tracking
+        //
+        // @param tracker       the tracker
+        //
+        void env_tracker_destroy(env_tracker_t* tracker);
+
+        // the current fingerprint
+        //
+        // @param tracker       the tracker
+        //
+        // @return              the fingerprint
+        //
+        env_fingerprint_t env_tracker_fingerprint(env_tracker_t const* tracker);
+
+        // recompute the fingerprint from scratch
+        //
+        // @param tracker       the tracker
+        //
+        // @return              true or false
+        //
+        bool env_tracker_reset(env_tracker_t* tracker);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_FINGERPRINT_H__
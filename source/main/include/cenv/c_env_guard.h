@@ -0,0 +1,85 @@
+#ifndef __CENV_ENV_GUARD_H__
+#define __CENV_ENV_GUARD_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // a guard journals the variables that are changed through the mutators of c_env.h
+        // (env_set, env_add, env_save and env_remove) while it is active, the first change
+        // of a variable records its old value. a rollback restores exactly those variables
+        // and skips the ones that are back at their old value already.
+        //
+        // guards nest, only the innermost guard journals and guards must end in reverse
+        // order. like the environment itself a guard is not thread-safe.
+        //
+        struct env_guard_t;
+
+        // begin a guard, it becomes the innermost guard
+        //
+        // @return              the guard or null if it could not be allocated
+        //
+        env_guard_t* env_guard_begin(void);
+
+        // restore the journaled variables, the guard stays active with an empty journal
+        //
+        // @param guard         the guard, it must be the innermost one, null does nothing
+        //
+        void env_guard_rollback(env_guard_t* guard);
+
+        // restore the journaled variables and end the guard
+        //
+        // @param guard         the guard, it must be the innermost one, null does nothing
+        //
+        void env_guard_end(env_guard_t* guard);
+
+        // the number of journaled variables
+        //
+        // @param guard         the guard
+        //
+        // @return              the number of variables
+        //
+        uint_t env_guard_size(env_guard_t const* guard);
+
+        // a guard for the lifetime of a scope
+        //
+        // @code
+        //
+        //            {
+        //                env_scope_t scope;
+        //                env_set("LANG", "C");
+        //                env_remove("HOME");
+        //                // ...
+        //            }   // LANG and HOME are back
+        //
+        // @endcode
+        //
+        class env_scope_t
+        {
+        public:
+            inline env_scope_t()
+                : m_guard(env_guard_begin())
+            {
+            }
+            inline ~env_scope_t() { env_guard_end(m_guard); }
+
+            inline void   rollback() { env_guard_rollback(m_guard); }
+            inline uint_t size() const { return env_guard_size(m_guard); }
+
+        private:
+            env_scope_t(env_scope_t const&);
+            env_scope_t& operator=(env_scope_t const&);
+
+            env_guard_t* m_guard;
+        };
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_GUARD_H__
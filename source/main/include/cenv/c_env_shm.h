@@ -0,0 +1,160 @@
+#ifndef __CENV_ENV_SHM_H__
+#define __CENV_ENV_SHM_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "cenv/c_env_snapshot.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // an environment store in a shared memory segment
+        //
+        // one publisher writes snapshots (see c_env_snapshot.h) into the segment, any
+        // number of processes read them without locks and without copying. the segment
+        // holds two snapshot buffers, a new version is written into the buffer that is
+        // not current and then made current with a single atomic store.
+        //
+        // every buffer is guarded by a sequence counter, a reader validates the counter
+        // after a lookup, a view handed out stays valid until the publisher has published
+        // two more versions, env_shm_valid tells if that has happened.
+        //
+        // only available on TARGET_LINUX (memfd) and TARGET_MAC (shm_open).
+        //
+        struct env_shm_t;
+
+        // a reader of the store, one per thread
+        struct env_shm_reader_t
+        {
+            env_shm_t*            m_shm;
+            env_snapshot_t const* m_snap;
+            u64                   m_version;
+            u64                   m_seq;
+            u32                   m_buffer;
+        };
+
+        // create a new store
+        //
+        // the segment is inherited by forked child processes, the file descriptor is
+        // not close-on-exec, so it can also be handed to exec'ed workers.
+        //
+        // the published snapshots are built with the given flags, readers see them in the
+        // snapshot header, so env_snapshot_case_insensitive carries over to every reader.
+        //
+        // @param capacity      the size in bytes of each of the two snapshot buffers
+        // @param flags         the snapshot flags, env_snapshot_default or env_snapshot_case_insensitive
+        //
+        // @return              the store or null
+        //
+        env_shm_t* env_shm_create(uint_t capacity, u32 flags);
+
+        // attach to an existing store from its file descriptor, read only
+        //
+        // @param fd            the file descriptor of the segment
+        //
+        // @return              the store or null
+        //
+        env_shm_t* env_shm_attach(int fd);
+
+        // close the store, this unmaps the segment and closes the descriptor
+        //
+        // @param shm           the store
+        //
+        void env_shm_close(env_shm_t* shm);
+
+        // the file descriptor of the segment
+        //
+        // @param shm           the store
+        //
+        // @return              the file descriptor
+        //
+        int env_shm_fd(env_shm_t const* shm);
+
+        // the current version, 0 if nothing has been published yet
+        //
+        // @param shm           the store
+        //
+        // @return              the version
+        //
+        u64 env_shm_version(env_shm_t const* shm);
+
+        // publish a set of variables as a new version
+        //
+        // there must only be one publisher at a time
+        //
+        // @param shm           the store, created by env_shm_create
+        // @param vars          the variables, each one in the form "NAME=VALUE"
+        // @param count         the variable count
+        //
+        // @return              the new version or 0 if the variables do not fit
+        //
+        u64 env_shm_publish(env_shm_t* shm, char const* const* vars, uint_t count);
+
+        // publish the environment of the current process as a new version
+        //
+        // @param shm           the store, created by env_shm_create
+        //
+        // @return              the new version or 0 if the environment does not fit
+        //
+        u64 env_shm_publish_live(env_shm_t* shm);
+
+        // init a reader
+        //
+        // @param reader        the reader
+        // @param shm           the store
+        //
+        void env_shm_reader_init(env_shm_reader_t* reader, env_shm_t* shm);
+
+        // pick up the newest version, this is one atomic load when nothing changed
+        //
+        // @param reader        the reader
+        //
+        // @return              true if the reader moved to a new version
+        //
+        bool env_shm_refresh(env_shm_reader_t* reader);
+
+        // find the value of a variable in the version of the reader
+        //
+        // when the buffer of the reader was overwritten the reader is refreshed first
+        //
+        // @code
+        //
+        //            env_shm_reader_t reader;
+        //            env_shm_reader_init(&reader, shm);
+        //            while (serving)
+        //            {
+        //                env_shm_refresh(&reader);
+        //
+        //                env_view_t level;
+        //                if (env_shm_find(&reader, "LOG_LEVEL", &level))
+        //                {
+        //                    // ...
+        //                }
+        //            }
+        //
+        // @endcode
+        //
+        // @param reader        the reader
+        // @param name          the variable name
+        // @param value         the variable value
+        //
+        // @return              true or false
+        //
+        bool env_shm_find(env_shm_reader_t* reader, char const* name, env_view_t* value);
+
+        // are the views handed out by the reader still intact
+        //
+        // @param reader        the reader
+        //
+        // @return              true or false
+        //
+        bool env_shm_valid(env_shm_reader_t const* reader);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_SHM_H__
@@ -0,0 +1,168 @@
+#ifndef __CENV_ENV_SNAPSHOT_H__
+#define __CENV_ENV_SNAPSHOT_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // a zero-copy view of a name or a value inside a snapshot
+        //
+        // the string is always zero terminated, m_len does not include the terminator
+        //
+        struct env_view_t
+        {
+            char const* m_str;
+            u32         m_len;
+        };
+
+        // an immutable, position independent image of a set of environment variables
+        //
+        // the layout is one contiguous block that only uses offsets, so it can be copied
+        // around, written to a file or placed in memory that is shared between processes:
+        //
+        //     header | entries (sorted by name) | hash index | blob ("name\0value\0" ...)
+        //
+        struct env_snapshot_t;
+
+        // the snapshot flags
+        //
+        // env_snapshot_case_insensitive compares names with the ASCII letters folded, like
+        // windows does. lookups and prefix queries ignore the case, the names keep their
+        // original case for iteration and export, and of the names that only differ in case
+        // the first one wins. the lookups hash and compare 8 bytes at a time and never copy
+        // the name. snapshots of the environment of a windows process are always created
+        // with this flag.
+        //
+        enum
+        {
+            env_snapshot_default          = 0,
+            env_snapshot_case_insensitive = 1,
+        };
+
+        // measure the number of bytes needed to build a snapshot of the given variables
+        //
+        // @param vars          the variables, each one in the form "NAME=VALUE"
+        // @param count         the variable count
+        //
+        // @return              the size in bytes
+        //
+        uint_t env_snapshot_measure(char const* const* vars, uint_t count);
+
+        // build a snapshot of the given variables into caller provided memory
+        //
+        // variables without a '=' are skipped, duplicate names keep the first occurrence
+        //
+        // @param mem           the memory to build the snapshot in, 8 byte aligned
+        // @param size          the size of the memory
+        // @param vars          the variables, each one in the form "NAME=VALUE"
+        // @param count         the variable count
+        // @param flags         the snapshot flags
+        //
+        // @return              the snapshot or null if the memory is too small
+        //
+        env_snapshot_t const* env_snapshot_build(void* mem, uint_t size, char const* const* vars, uint_t count, u32 flags);
+
+        // create a snapshot of the environment of the current process
+        //
+        // @param flags         the snapshot flags
+        //
+        // @return              the snapshot, release it with env_snapshot_destroy
+        //
+        env_snapshot_t* env_snapshot_create(u32 flags);
+
+        // destroy a snapshot created by env_snapshot_create
+        //
+        // @param snap          the snapshot
+        //
+        void env_snapshot_destroy(env_snapshot_t* snap);
+
+        // the size in bytes of the snapshot image
+        //
+        // @param snap          the snapshot
+        //
+        // @return              the size in bytes
+        //
+        uint_t env_snapshot_bytes(env_snapshot_t const* snap);
+
+        // the variable count of the snapshot
+        //
+        // @param snap          the snapshot
+        //
+        // @return              the variable count
+        //
+        uint_t env_snapshot_size(env_snapshot_t const* snap);
+
+        // get the variable at the given index, variables are sorted by name
+        //
+        // @param snap          the snapshot
+        // @param index         the variable index
+        // @param name          the variable name
+        // @param value         the variable value
+        //
+        // @return              true or false
+        //
+        bool env_snapshot_at(env_snapshot_t const* snap, uint_t index, env_view_t* name, env_view_t* value);
+
+        // find the value of a variable
+        //
+        // @code
+        //
+        //            env_snapshot_t* snap = env_snapshot_create(env_snapshot_default);
+        //            if (snap)
+        //            {
+        //                env_view_t home;
+        //                if (env_snapshot_find(snap, "HOME", &home))
+        //                {
+        //                    // ...
+        //                }
+        //                env_snapshot_destroy(snap);
+        //            }
+        //
+        // @endcode
+        //
+        // @param snap          the snapshot
+        // @param name          the variable name
+        // @param value         the variable value
+        //
+        // @return              true or false
+        //
+        bool env_snapshot_find(env_snapshot_t const* snap, char const* name, env_view_t* value);
+
+        // get the range of variables whose name starts with the given prefix
+        //
+        // the names are sorted so the matches are adjacent, this is two binary searches
+        //
+        // @code
+        //
+        //            uint_t first, end;
+        //            if (env_snapshot_prefix(snap, "OTEL_", &first, &end))
+        //            {
+        //                env_view_t name, value;
+        //                for (uint_t i = first; i < end; ++i)
+        //                {
+        //                    env_snapshot_at(snap, i, &name, &value);
+        //                    // ...
+        //                }
+        //            }
+        //
+        // @endcode
+        //
+        // @param snap          the snapshot
+        // @param prefix        the name prefix, an empty prefix matches every variable
+        // @param first         the index of the first match
+        // @param end           the index after the last match
+        //
+        // @return              true if there is at least one match
+        //
+        bool env_snapshot_prefix(env_snapshot_t const* snap, char const* prefix, uint_t* first, uint_t* end);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_SNAPSHOT_H__
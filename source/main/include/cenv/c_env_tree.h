@@ -0,0 +1,90 @@
+#ifndef __CENV_ENV_TREE_H__
+#define __CENV_ENV_TREE_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "cenv/c_env_snapshot.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // a node of a nested key tree
+        //
+        // the key is a segment of a variable name and is NOT zero terminated, the value
+        // is the value of the variable that ends at this node, m_value.m_str is null when
+        // no variable ends here. both point into the snapshot the tree was built from.
+        // the keys of a tree that is built from an env_snapshot_case_insensitive snapshot
+        // compare with the ASCII letters folded, m_fold is set on every node of such a tree.
+        // the children of a node are m_child[0] to m_child[m_child_count - 1], ordered by key,
+        // m_next links them as well.
+        //
+        struct env_node_t
+        {
+            env_view_t  m_key;
+            env_view_t  m_value;
+            env_node_t* m_child;
+            env_node_t* m_next;
+            u32         m_child_count;
+            bool        m_fold;
+        };
+
+        struct env_tree_t;
+
+        // build a nested key tree of the variables under a prefix
+        //
+        // the names are split on the delimiter after the prefix has been stripped,
+        // with the prefix "APP__" and the delimiter "__" the variables
+        //
+        //     APP__CACHE__SIZE=64
+        //     APP__CACHE__TTL=10
+        //     APP__NAME=demo
+        //
+        // become the tree
+        //
+        //     APP__
+        //       CACHE
+        //         SIZE = 64
+        //         TTL  = 10
+        //       NAME = demo
+        //
+        // the tree references the snapshot, destroy the tree before the snapshot.
+        //
+        // @param snap          the snapshot
+        // @param prefix        the name prefix
+        // @param delimiter     the segment delimiter, for example "__"
+        //
+        // @return              the tree, release it with env_tree_destroy
+        //
+        env_tree_t* env_tree_build(env_snapshot_t const* snap, char const* prefix, char const* delimiter);
+
+        // destroy the tree
+        //
+        // @param tree          the tree
+        //
+        void env_tree_destroy(env_tree_t* tree);
+
+        // the root of the tree, its key is the prefix
+        //
+        // @param tree          the tree
+        //
+        // @return              the root node
+        //
+        env_node_t const* env_tree_root(env_tree_t const* tree);
+
+        // find the child of a node with the given key, a binary search over the children
+        //
+        // @param node          the parent node
+        // @param key           the key of the child
+        //
+        // @return              the child or null
+        //
+        env_node_t const* env_tree_child(env_node_t const* node, char const* key);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_TREE_H__
@@ -0,0 +1,71 @@
+#ifndef __CENV_ENV_UTF_H__
+#define __CENV_ENV_UTF_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // utf-8 <-> utf-16 transcoding for the wide character environment
+        //
+        // the _len functions validate the input and return the exact output length, so
+        // the caller can allocate once. the conversion functions do not write a terminator.
+        //
+        // with SSE2, utf-8 is validated and decoded 16 bytes at a time, 1 to 4 byte
+        // sequences alike. ascii runs are handled 16 bytes at a time with NEON and 8
+        // bytes at a time otherwise. define CENV_UTF_NO_SIMD to force the latter.
+        //
+        static const uint_t env_utf_invalid = (uint_t)-1;
+
+        // the number of utf-16 units needed for a utf-8 string
+        //
+        // @param src           the utf-8 string
+        // @param len           the length in bytes
+        //
+        // @return              the number of units or env_utf_invalid
+        //
+        uint_t env_utf8_to_utf16_len(char const* src, uint_t len);
+
+        // convert a utf-8 string to utf-16
+        //
+        // the input is validated on the way, a string never needs more units than it has
+        // bytes, so with room for len units the env_utf8_to_utf16_len pass can be skipped.
+        //
+        // @param src           the utf-8 string
+        // @param len           the length in bytes
+        // @param dst           the output, room for env_utf8_to_utf16_len units
+        //
+        // @return              the number of units written or env_utf_invalid
+        //
+        uint_t env_utf8_to_utf16(char const* src, uint_t len, u16* dst);
+
+        // the number of utf-8 bytes needed for a utf-16 string
+        //
+        // unpaired surrogates are invalid
+        //
+        // @param src           the utf-16 string
+        // @param len           the length in units
+        //
+        // @return              the number of bytes or env_utf_invalid
+        //
+        uint_t env_utf16_to_utf8_len(u16 const* src, uint_t len);
+
+        // convert a validated utf-16 string to utf-8
+        //
+        // @param src           the utf-16 string
+        // @param len           the length in units
+        // @param dst           the output, room for env_utf16_to_utf8_len bytes
+        //
+        // @return              the number of bytes written
+        //
+        uint_t env_utf16_to_utf8(u16 const* src, uint_t len, char* dst);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_UTF_H__
@@ -0,0 +1,102 @@
+#ifndef __CENV_ENV_WATCH_H__
+#define __CENV_ENV_WATCH_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "cenv/c_env_snapshot.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // subscribe to the changes made through the mutators of c_env.h (env_set, env_add,
+        // env_save and env_remove) and through guard rollbacks, see c_env_guard.h
+        //
+        // changes are coalesced per subscriber and per variable: the first old value is kept
+        // and the new value is read when the change is delivered, a variable that ends up at
+        // its old value is not reported. a subscriber gets one callback with all its changes,
+        //
+        //  - env_watch_sync, at the end of the outermost batch or right after a mutation
+        //    that is not in a batch
+        //  - env_watch_deferred, when the owner calls env_watch_pump
+        //
+        // a mutation of a variable that nobody watches costs a few hash probes and does not
+        // allocate. like the environment itself this is not thread-safe.
+        //
+        struct env_watch_t;
+
+        enum env_watch_mode_t
+        {
+            env_watch_sync     = 0,
+            env_watch_deferred = 1,
+        };
+
+        // one coalesced change, m_str of m_old or m_new is null when the variable did not exist
+        //
+        // the views are only valid during the callback
+        //
+        struct env_change_t
+        {
+            env_view_t m_name;
+            env_view_t m_old;
+            env_view_t m_new;
+        };
+
+        typedef void (*env_watch_fn)(void* user, env_change_t const* changes, uint_t count);
+
+        // subscribe
+        //
+        // @code
+        //
+        //            static void on_proxy(void* user, env_change_t const* changes, uint_t count)
+        //            {
+        //                for (uint_t i = 0; i < count; ++i)
+        //                {
+        //                    // changes[i].m_name, changes[i].m_old, changes[i].m_new
+        //                }
+        //            }
+        //
+        //            env_watch_t* watch = env_watch("HTTP_PROXY", false, env_watch_sync, on_proxy, null);
+        //            env_batch_begin();
+        //            env_set("HTTP_PROXY", "http://a:8080");
+        //            env_set("HTTP_PROXY", "http://b:8080");
+        //            env_batch_end();   // one callback, old value -> http://b:8080
+        //            env_unwatch(watch);
+        //
+        // @endcode
+        //
+        // @param key           the variable name or the name prefix
+        // @param prefix        is the key a prefix?
+        // @param mode          the dispatch mode
+        // @param fn            the callback
+        // @param user          the user data passed to the callback
+        //
+        // @return              the subscription
+        //
+        env_watch_t* env_watch(char const* key, bool prefix, env_watch_mode_t mode, env_watch_fn fn, void* user);
+
+        // unsubscribe, pending changes are dropped
+        //
+        // @param watch         the subscription
+        //
+        void env_unwatch(env_watch_t* watch);
+
+        // begin a batch, batches nest
+        void env_batch_begin(void);
+
+        // end a batch, the end of the outermost batch delivers to the sync subscribers
+        void env_batch_end(void);
+
+        // deliver the pending changes of the deferred subscribers
+        //
+        // @return              the number of callbacks made
+        //
+        uint_t env_watch_pump(void);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_WATCH_H__
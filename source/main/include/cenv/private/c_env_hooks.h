@@ -0,0 +1,45 @@
+#ifndef __CENV_ENV_HOOKS_H__
+#define __CENV_ENV_HOOKS_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+        // the native environment, without going through the hooks
+
+        // get the value of a variable, null if it does not exist
+        //
+        // the value is borrowed, release it with env_native_release before the variable changes
+        //
+        char const* env_native_acquire(char const* name, uint_t* psize);
+        void        env_native_release(char const* value);
+
+        // set a variable, a null value removes it
+        bool env_native_set(char const* name, char const* value);
+
+        // the hooks, every mutator in c_env.h calls env_hook_before right before it changes a
+        // variable and env_hook_after right after, also when the change failed
+        void env_hook_before(char const* name);
+        void env_hook_after(char const* name);
+
+        // journal a variable in the active guard, see c_env_guard.h
+        void env_guard_journal(char const* name);
+
+        // record the old value for the subscribers and deliver the change, see c_env_watch.h
+        void env_watch_before(char const* name);
+        void env_watch_after(char const* name);
+
+        // move the tracked fingerprints from the old value to the new one, see c_env_fingerprint.h
+        void env_fingerprint_before(char const* name);
+        void env_fingerprint_after(char const* name);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_HOOKS_H__
@@ -0,0 +1,118 @@
+#ifndef __CENV_ENV_SNAPSHOT_LAYOUT_H__
+#define __CENV_ENV_SNAPSHOT_LAYOUT_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include <string.h>
+
+#include "cenv/c_env_snapshot.h"
+
+namespace ncore
+{
+    namespace nenv
+    {
+#define CENV_SNAPSHOT_MAGIC 0x564E4543 // 'CENV'
+
+        // the snapshot header, all offsets are relative to the start of the header
+        struct env_snapshot_t
+        {
+            u32 m_magic;
+            u32 m_flags;
+            u32 m_count;    // number of entries
+            u32 m_slots;    // number of hash slots, power of two
+            u32 m_bytes;    // total size of the image
+            u32 m_entries;  // offset of the entry array
+            u32 m_index;    // offset of the hash index
+            u32 m_blob;     // offset of the string blob
+        };
+
+        // one variable, offsets are relative to the blob
+        struct env_entry_t
+        {
+            u32 m_name;
+            u32 m_name_len;
+            u32 m_value;
+            u32 m_value_len;
+            u32 m_hash;
+        };
+
+        // the name hash used by the snapshot index
+        u32 env_hash_name(char const* name, uint_t len);
+
+        // the name hash of case-insensitive snapshots, the ASCII letters are folded to lower case
+        u32 env_hash_name_folded(char const* name, uint_t len);
+
+        // are two names of the same length equal with the ASCII letters folded
+        bool env_name_equal_folded(char const* a, char const* b, uint_t len);
+
+        // the order of the snapshot entries, bytewise with the ASCII letters folded when fold is set,
+        // a name sorts before the longer names it is a prefix of
+        s32 env_name_compare(char const* a, u32 alen, char const* b, u32 blen, bool fold);
+
+        // load up to 8 bytes, zero padded
+        static inline u64 env_load_word(u8 const* p, uint_t len)
+        {
+            u64 w = 0;
+            memcpy(&w, p, len < 8 ? len : 8);
+            return w;
+        }
+
+        // load up to 8 bytes without a call or a branch per byte, the loads overlap and every byte
+        // is covered, so two names of the same length are equal when their words are
+        static inline u64 env_load_short(u8 const* p, uint_t len)
+        {
+            if (len >= 4)
+            {
+                u32 lo, hi;
+                memcpy(&lo, p, 4);
+                memcpy(&hi, p + len - 4, 4);
+                return (u64)lo | ((u64)hi << 32);
+            }
+            return len ? ((u64)p[0] | ((u64)p[len >> 1] << 8) | ((u64)p[len - 1] << 16)) : 0;
+        }
+
+        // fold the ASCII letters of 8 bytes to lower case at once, other bytes are left alone
+        static inline u64 env_fold_word(u64 w)
+        {
+            u64 const ones  = 0x0101010101010101ull;
+            u64 const low   = w & (ones * 0x7F);
+            u64 const ge_a  = low + ones * (0x80 - 'A');
+            u64 const gt_z  = low + ones * (0x80 - 'Z' - 1);
+            u64 const upper = ge_a & ~gt_z & ~w & (ones * 0x80);
+            return w | (upper >> 2);
+        }
+
+        static inline u8 env_fold_char(u8 c) { return (u8)(c - 'A') < 26 ? (u8)(c | 0x20) : c; }
+
+        // names hash and compare like the native environment, case-insensitive on windows
+        static inline u32 env_hash_name_native(char const* name, uint_t len)
+        {
+#if defined(TARGET_OS_WINDOWS)
+            return env_hash_name_folded(name, len);
+#else
+            return env_hash_name(name, len);
+#endif
+        }
+
+        static inline bool env_name_equal_native(char const* a, char const* b, uint_t len)
+        {
+#if defined(TARGET_OS_WINDOWS)
+            return env_name_equal_folded(a, b, len);
+#else
+            return memcmp(a, b, len) == 0;
+#endif
+        }
+
+        // find a variable in an image that may be concurrently overwritten
+        //
+        // every offset is checked against limit before it is dereferenced, so a torn
+        // image can make this return garbage but never read outside of [snap, snap + limit)
+        //
+        bool env_snapshot_find_bounded(env_snapshot_t const* snap, uint_t limit, char const* name, uint_t len, env_view_t* value);
+
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_ENV_SNAPSHOT_LAYOUT_H__
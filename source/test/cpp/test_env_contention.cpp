@@ -0,0 +1,429 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_console.h"
+#include "cenv/c_env.h"
+#include "cenv/c_env_shm.h"
+#include "cenv/c_env_snapshot.h"
+#include "cenv/test_bench.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+#    include <pthread.h>
+#    include <sched.h>
+
+extern char** environ;
+#endif
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+// readers against writers of the environment, one row per strategy and thread mix
+//
+//  - direct, readers call env_first and env_get, the c library is the synchronization
+//  - snapshot, every reader keeps its own snapshot and rebuilds it in its own memory when the
+//    generation moves
+//  - store, the writers publish into a shared memory store, the readers use a store reader
+//
+// every writer op is an env_set, the store writers also publish under a mutex since the store
+// has one publisher. a value is "T:T:T" where T is a self-checking token, a reader that sees
+// anything else counts an error. the variables exist before the threads start and are only
+// overwritten, the direct strategy is not safe with a c library that frees replaced values.
+//
+// every row runs for a second, CENV_BENCH_MS changes that. the samples column is the number of
+// timed ops behind the percentiles of the row, the bench only runs when CENV_BENCH is set.
+//
+// env_load and env_save are not exercised, env_init that would create their env_t is not part
+// of this package.
+//
+UNITTEST_SUITE_BEGIN(test_env_contention)
+{
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+    UNITTEST_FIXTURE(bench)
+    {
+#    define CENV_CT_VARS 8
+#    define CENV_CT_THREADS 64
+#    define CENV_CT_BUCKETS 512
+#    define CENV_CT_VALUE 64
+
+        enum strategy_t
+        {
+            strategy_direct   = 0,
+            strategy_snapshot = 1,
+            strategy_store    = 2,
+        };
+
+        // log2 buckets with 8 linear sub-buckets, the error is at most 12.5%
+        struct histogram_t
+        {
+            u64 m_buckets[CENV_CT_BUCKETS];
+            u64 m_count;
+        };
+
+        struct worker_t
+        {
+            pthread_t   m_thread;
+            s32         m_index;
+            bool        m_writer;
+            u64         m_ops;
+            u64         m_errors;
+            u64         m_retries;
+            u64         m_ns;
+            void*       m_snapshot; // the snapshot memory of a reader, allocated by the main thread
+            uint_t      m_snapshot_size;
+            histogram_t m_histogram;
+        };
+
+        static char const*     s_names[CENV_CT_VARS] = {"CENV_CT_0", "CENV_CT_1", "CENV_CT_2", "CENV_CT_3", "CENV_CT_4", "CENV_CT_5", "CENV_CT_6", "CENV_CT_7"};
+        static char            s_vars[CENV_CT_VARS][CENV_CT_VALUE + 16];
+        static char const*     s_var_ptrs[CENV_CT_VARS];
+        static strategy_t      s_strategy;
+        static volatile s32    s_ready;
+        static volatile s32    s_go;
+        static volatile s32    s_stop;
+        static u64             s_generation;
+        static env_shm_t*      s_shm;
+        static pthread_mutex_t s_publish = PTHREAD_MUTEX_INITIALIZER;
+        static worker_t        s_workers[CENV_CT_THREADS];
+
+        static inline u32 bucket_of(u64 ns)
+        {
+            if (ns < 8)
+                return (u32)ns;
+            u32 const msb = 63 - (u32)__builtin_clzll(ns);
+            return (msb - 2) * 8 + (u32)((ns >> (msb - 3)) & 7);
+        }
+
+        static inline u64 bucket_value(u32 bucket)
+        {
+            if (bucket < 8)
+                return bucket;
+            u32 const msb = bucket / 8 + 2;
+            return (u64)(8 + bucket % 8) << (msb - 3);
+        }
+
+        static inline void record(histogram_t* h, u64 ns)
+        {
+            h->m_buckets[bucket_of(ns)]++;
+            h->m_count++;
+        }
+
+        static u64 percentile(histogram_t const* h, u64 permille)
+        {
+            u64 const rank = (h->m_count * permille + 999) / 1000;
+            u64       seen = 0;
+            for (u32 i = 0; i < CENV_CT_BUCKETS; ++i)
+            {
+                seen += h->m_buckets[i];
+                if (seen >= rank && seen > 0)
+                    return bucket_value(i);
+            }
+            return 0;
+        }
+
+        // a token is 8 hex digits of the sequence and 8 hex digits of its check
+        static inline u32 token_check(u32 seq) { return (u32)(((u64)seq * 0x9E3779B97F4A7C15ull) >> 32); }
+
+        static void make_value(char* value, u32 seq)
+        {
+            char token[17];
+            snprintf(token, sizeof(token), "%08x%08x", seq, token_check(seq));
+            snprintf(value, CENV_CT_VALUE, "%s:%s:%s", token, token, token);
+        }
+
+        static bool parse_hex(char const* str, u32* value)
+        {
+            u32 v = 0;
+            for (s32 i = 0; i < 8; ++i)
+            {
+                char const c = str[i];
+                if (c >= '0' && c <= '9')
+                    v = (v << 4) | (u32)(c - '0');
+                else if (c >= 'a' && c <= 'f')
+                    v = (v << 4) | (u32)(c - 'a' + 10);
+                else
+                    return false;
+            }
+            *value = v;
+            return true;
+        }
+
+        static bool check_token(char const* token)
+        {
+            u32 seq, check;
+            return parse_hex(token, &seq) && parse_hex(token + 8, &check) && check == token_check(seq);
+        }
+
+        static bool check_value(char const* value, uint_t len)
+        {
+            // three equal tokens
+            if (len != 16 * 3 + 2 || value[16] != ':' || value[33] != ':')
+                return false;
+            return check_token(value) && memcmp(value, value + 17, 16) == 0 && memcmp(value, value + 34, 16) == 0;
+        }
+
+        static bool read_direct(s32 var, u64 op)
+        {
+            char value[CENV_CT_VALUE];
+            if (op & 1)
+            {
+                uint_t const len = env_get(s_names[var], value, sizeof(value));
+                return check_value(value, len);
+            }
+            uint_t const len = env_first(s_names[var], value, sizeof(value));
+            return len == 16 && check_token(value);
+        }
+
+        static inline uint_t environ_count()
+        {
+            uint_t count = 0;
+            while (environ && environ[count])
+                count++;
+            return count;
+        }
+
+        // the snapshot is rebuilt in the memory of the reader, the allocator of the test counts
+        // its allocations without synchronization and is not touched by the worker threads
+        static bool read_snapshot(s32 var, worker_t* w, env_snapshot_t const** snap, u64* generation)
+        {
+            u64 const current = __atomic_load_n(&s_generation, __ATOMIC_ACQUIRE);
+            if (*snap == null || current != *generation)
+            {
+                *snap       = env_snapshot_build(w->m_snapshot, w->m_snapshot_size, (char const* const*)environ, environ_count(), env_snapshot_default);
+                *generation = current;
+            }
+
+            env_view_t value;
+            return *snap && env_snapshot_find(*snap, s_names[var], &value) && check_value(value.m_str, value.m_len);
+        }
+
+        static bool read_store(s32 var, env_shm_reader_t* reader, worker_t* w)
+        {
+            char value[CENV_CT_VALUE];
+            while (true)
+            {
+                env_shm_refresh(reader);
+
+                env_view_t view;
+                if (!env_shm_find(reader, s_names[var], &view))
+                    return false;
+
+                // copy, then make sure the publisher did not overwrite what we copied
+                uint_t const len = view.m_len < CENV_CT_VALUE ? view.m_len : CENV_CT_VALUE - 1;
+                memcpy(value, view.m_str, len);
+                value[len] = '\0';
+                if (env_shm_valid(reader))
+                    return check_value(value, len);
+                w->m_retries++;
+            }
+        }
+
+        static void write_value(s32 var, u32 seq)
+        {
+            char value[CENV_CT_VALUE];
+            make_value(value, seq);
+            env_set(s_names[var], value);
+
+            if (s_strategy == strategy_snapshot)
+                __atomic_fetch_add(&s_generation, 1, __ATOMIC_RELEASE);
+            else if (s_strategy == strategy_store)
+            {
+                pthread_mutex_lock(&s_publish);
+                snprintf(s_vars[var], sizeof(s_vars[var]), "%s=%s", s_names[var], value);
+                env_shm_publish(s_shm, s_var_ptrs, CENV_CT_VARS);
+                pthread_mutex_unlock(&s_publish);
+            }
+        }
+
+        static void* worker_main(void* arg)
+        {
+            worker_t* w = (worker_t*)arg;
+
+            env_snapshot_t const* snap       = null;
+            u64                   generation = 0;
+            env_shm_reader_t      reader;
+            if (s_strategy == strategy_store)
+                env_shm_reader_init(&reader, s_shm);
+
+            // everybody starts at the same time
+            __atomic_fetch_add(&s_ready, 1, __ATOMIC_RELEASE);
+            while (!__atomic_load_n(&s_go, __ATOMIC_ACQUIRE))
+                sched_yield();
+
+            u64 const start = bench_now_ns();
+            u64       op    = 0;
+            while (!__atomic_load_n(&s_stop, __ATOMIC_RELAXED))
+            {
+                s32 const var = (s32)((op + (u64)w->m_index) % CENV_CT_VARS);
+                u64 const t0  = bench_now_ns();
+                bool      ok  = true;
+                if (w->m_writer)
+                    write_value(var, ((u32)w->m_index << 24) | (u32)(op & 0xFFFFFF));
+                else if (s_strategy == strategy_direct)
+                    ok = read_direct(var, op);
+                else if (s_strategy == strategy_snapshot)
+                    ok = read_snapshot(var, w, &snap, &generation);
+                else
+                    ok = read_store(var, &reader, w);
+                u64 const t1 = bench_now_ns();
+
+                record(&w->m_histogram, t1 - t0);
+                if (!ok)
+                    w->m_errors++;
+                op++;
+            }
+            w->m_ns  = bench_now_ns() - start;
+            w->m_ops = op;
+            return null;
+        }
+
+        struct summary_t
+        {
+            histogram_t m_histogram;
+            double      m_mean; // ops per second per thread
+            double      m_min;
+            u64         m_errors;
+            u64         m_retries;
+        };
+
+        static void summarize(s32 first, s32 end, summary_t* s)
+        {
+            memset(s, 0, sizeof(summary_t));
+            for (s32 i = first; i < end; ++i)
+            {
+                worker_t const& w    = s_workers[i];
+                double const    rate = w.m_ns ? (double)w.m_ops * 1e9 / (double)w.m_ns : 0.0;
+                s->m_mean += rate / (double)(end - first);
+                s->m_min = (i == first || rate < s->m_min) ? rate : s->m_min;
+                s->m_errors += w.m_errors;
+                s->m_retries += w.m_retries;
+                for (u32 b = 0; b < CENV_CT_BUCKETS; ++b)
+                    s->m_histogram.m_buckets[b] += w.m_histogram.m_buckets[b];
+                s->m_histogram.m_count += w.m_histogram.m_count;
+            }
+        }
+
+        static u64 run(strategy_t strategy, s32 readers, s32 writers, u64 duration_ns)
+        {
+            s32 const threads = readers + writers;
+            ASSERT(threads <= CENV_CT_THREADS);
+
+            s_strategy = strategy;
+            s_ready    = 0;
+            s_go       = 0;
+            s_stop     = 0;
+            for (s32 v = 0; v < CENV_CT_VARS; ++v)
+            {
+                char value[CENV_CT_VALUE];
+                make_value(value, (u32)v);
+                env_set(s_names[v], value);
+                snprintf(s_vars[v], sizeof(s_vars[v]), "%s=%s", s_names[v], value);
+                s_var_ptrs[v] = s_vars[v];
+            }
+            if (strategy == strategy_store)
+                env_shm_publish(s_shm, s_var_ptrs, CENV_CT_VARS);
+
+            // the values are only overwritten with values of the same length, the size of the
+            // environment does not change while the threads run, twice that leaves room
+            alloc_t*     allocator = context_t::system_alloc();
+            uint_t const snapshot  = strategy == strategy_snapshot ? env_snapshot_measure((char const* const*)environ, environ_count()) * 2 : 0;
+
+            s32 started = 0;
+            for (s32 i = 0; i < threads; ++i)
+            {
+                worker_t& w = s_workers[i];
+                memset(&w, 0, sizeof(worker_t));
+                w.m_index  = i;
+                w.m_writer = i >= readers;
+                if (snapshot && !w.m_writer)
+                {
+                    w.m_snapshot      = allocator->allocate((u32)snapshot, 8);
+                    w.m_snapshot_size = snapshot;
+                }
+                if (pthread_create(&w.m_thread, null, worker_main, &w) != 0)
+                    break;
+                started++;
+            }
+
+            while (__atomic_load_n(&s_ready, __ATOMIC_ACQUIRE) < started)
+                sched_yield();
+            __atomic_store_n(&s_go, 1, __ATOMIC_RELEASE);
+
+            timespec ts;
+            ts.tv_sec  = (time_t)(duration_ns / 1000000000ull);
+            ts.tv_nsec = (long)(duration_ns % 1000000000ull);
+            nanosleep(&ts, null);
+            __atomic_store_n(&s_stop, 1, __ATOMIC_RELAXED);
+            for (s32 i = 0; i < started; ++i)
+                pthread_join(s_workers[i].m_thread, null);
+            for (s32 i = 0; i < threads; ++i)
+            {
+                if (s_workers[i].m_snapshot)
+                    allocator->deallocate(s_workers[i].m_snapshot);
+            }
+            CHECK_EQUAL(threads, started);
+
+            static char const* s_strategies[] = {"direct", "snapshot", "store"};
+            summary_t          r, w;
+            summarize(0, readers, &r);
+            summarize(readers, started, &w);
+
+            // the percentiles are only as good as the number of samples behind them
+            char line[320];
+            if (writers > 0)
+            {
+                snprintf(line, sizeof(line), "    %-9s %3d %3d | %9.0f %9.0f | %10llu %7llu %7llu %8llu | %9.0f %9.0f | %10llu %7llu %7llu %8llu | %6llu %7llu", s_strategies[strategy], readers, writers, r.m_mean / 1000.0, r.m_min / 1000.0,
+                         (unsigned long long)r.m_histogram.m_count, (unsigned long long)percentile(&r.m_histogram, 500), (unsigned long long)percentile(&r.m_histogram, 990), (unsigned long long)percentile(&r.m_histogram, 999), w.m_mean / 1000.0,
+                         w.m_min / 1000.0, (unsigned long long)w.m_histogram.m_count, (unsigned long long)percentile(&w.m_histogram, 500), (unsigned long long)percentile(&w.m_histogram, 990), (unsigned long long)percentile(&w.m_histogram, 999),
+                         (unsigned long long)r.m_errors, (unsigned long long)r.m_retries);
+            }
+            else
+            {
+                snprintf(line, sizeof(line), "    %-9s %3d %3d | %9.0f %9.0f | %10llu %7llu %7llu %8llu | %9s %9s | %10s %7s %7s %8s | %6llu %7llu", s_strategies[strategy], readers, writers, r.m_mean / 1000.0, r.m_min / 1000.0,
+                         (unsigned long long)r.m_histogram.m_count, (unsigned long long)percentile(&r.m_histogram, 500), (unsigned long long)percentile(&r.m_histogram, 990), (unsigned long long)percentile(&r.m_histogram, 999), "-", "-", "-", "-", "-", "-",
+                         (unsigned long long)r.m_errors, (unsigned long long)r.m_retries);
+            }
+            console->writeLine(line);
+            return r.m_errors + w.m_errors;
+        }
+
+        UNITTEST_FIXTURE_SETUP() { s_shm = env_shm_create(16 * 1024, env_snapshot_default); }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            env_shm_close(s_shm);
+            s_shm = null;
+            for (s32 v = 0; v < CENV_CT_VARS; ++v)
+                env_remove(s_names[v]);
+        }
+
+        UNITTEST_TEST(readers_vs_writers)
+        {
+            if (!bench_enabled("contention readers_vs_writers"))
+                return;
+
+            CHECK_NOT_NULL(s_shm);
+            if (!s_shm)
+                return;
+
+            // readers, writers, up to 64 threads
+            static s32 const mixes[][2] = {{1, 0}, {8, 0}, {1, 1}, {2, 1}, {4, 1}, {4, 4}, {8, 2}, {16, 4}, {32, 8}, {48, 16}};
+            s32 const        count      = (s32)(sizeof(mixes) / sizeof(mixes[0]));
+            u64 const        duration   = bench_duration_ns(1000); // per row, 30 rows
+
+            console->writeLine("    strategy    R   W |  read k/s   min k/s |    samples     p50     p99     p999 | write k/s   min k/s |    samples     p50     p99     p999 | errors retries");
+            console->writeLine("                      |   per thread        |         read latency (ns)           |   per thread        |         write latency (ns)          |");
+            for (s32 s = strategy_direct; s <= strategy_store; ++s)
+            {
+                for (s32 i = 0; i < count; ++i)
+                    CHECK_EQUAL(0, (s32)run((strategy_t)s, mixes[i][0], mixes[i][1], duration));
+            }
+        }
+    }
+
+#endif
+}
+UNITTEST_SUITE_END
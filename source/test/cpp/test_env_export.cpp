@@ -0,0 +1,168 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cenv/c_env_export.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+#    include <signal.h>
+#    include <unistd.h>
+extern char** environ;
+#endif
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+UNITTEST_SUITE_BEGIN(test_env_export)
+{
+    UNITTEST_FIXTURE(main)
+    {
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+        static char const* s_vars[] = {"B=it's", "A=plain", "C=say \"hi\" $HOME `x` \\ \nnext", "1BAD=skip"};
+
+        // export into a temporary file and read it back
+        static uint_t export_to(char* buffer, uint_t maxn, env_snapshot_t const* snap, env_export_format_t format)
+        {
+            FILE* file = tmpfile();
+            bool  ok   = snap ? env_export_snapshot(fileno(file), snap, format) : env_export_live(fileno(file), format);
+            if (!ok)
+            {
+                fclose(file);
+                return 0;
+            }
+            uint_t const size = (uint_t)lseek(fileno(file), 0, SEEK_END);
+            lseek(fileno(file), 0, SEEK_SET);
+            uint_t const n = size < maxn ? (uint_t)read(fileno(file), buffer, size) : 0;
+            fclose(file);
+            return n;
+        }
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(block)
+        {
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 4, env_snapshot_default);
+
+            char         out[512];
+            uint_t const n        = export_to(out, sizeof(out), snap, env_export_block);
+            char const   expect[] = "1BAD=skip\0A=plain\0B=it's\0C=say \"hi\" $HOME `x` \\ \nnext";
+            CHECK_EQUAL(sizeof(expect), n);
+            CHECK_EQUAL(0, memcmp(out, expect, sizeof(expect)));
+        }
+
+        UNITTEST_TEST(dotenv)
+        {
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 4, env_snapshot_default);
+
+            char         out[512];
+            uint_t const n      = export_to(out, sizeof(out), snap, env_export_dotenv);
+            char const*  expect = "1BAD=\"skip\"\nA=\"plain\"\nB=\"it's\"\nC=\"say \\\"hi\\\" \\$HOME \\`x\\` \\\\ \\nnext\"\n";
+            CHECK_EQUAL(strlen(expect), n);
+            CHECK_EQUAL(0, memcmp(out, expect, n));
+        }
+
+        UNITTEST_TEST(shell)
+        {
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 4, env_snapshot_default);
+
+            char         out[512];
+            uint_t const n      = export_to(out, sizeof(out), snap, env_export_shell);
+            char const*  expect = "export A='plain'\nexport B='it'\\''s'\nexport C='say \"hi\" $HOME `x` \\ \nnext'\n";
+            CHECK_EQUAL(strlen(expect), n);
+            CHECK_EQUAL(0, memcmp(out, expect, n));
+        }
+
+        UNITTEST_TEST(pipe)
+        {
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 2, env_snapshot_default);
+
+            int fds[2];
+            CHECK_EQUAL(0, ::pipe(fds));
+            CHECK_TRUE(env_export_snapshot(fds[1], snap, env_export_shell));
+            close(fds[1]);
+
+            char        out[128];
+            ssize_t     n      = read(fds[0], out, sizeof(out));
+            char const* expect = "export A='plain'\nexport B='it'\\''s'\n";
+            close(fds[0]);
+            CHECK_EQUAL((s32)strlen(expect), (s32)n);
+            CHECK_EQUAL(0, memcmp(out, expect, strlen(expect)));
+        }
+
+        UNITTEST_TEST(reader_gone)
+        {
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 2, env_snapshot_default);
+
+            // with SIGPIPE ignored the export fails instead of killing the process
+            void (*previous)(int) = signal(SIGPIPE, SIG_IGN);
+            int fds[2];
+            CHECK_EQUAL(0, ::pipe(fds));
+            close(fds[0]);
+            CHECK_FALSE(env_export_snapshot(fds[1], snap, env_export_shell));
+            close(fds[1]);
+            signal(SIGPIPE, previous);
+        }
+
+        UNITTEST_TEST(live)
+        {
+            // the block format of the live environment is the entries as they are
+            uint_t expect = 0;
+            for (char** p = environ; *p; ++p)
+            {
+                if (strchr(*p, '=') && **p != '=')
+                    expect += strlen(*p) + 1;
+            }
+
+            alloc_t*     allocator = context_t::system_alloc();
+            char*        out       = (char*)allocator->allocate((u32)expect + 1);
+            uint_t const n         = export_to(out, expect + 1, null, env_export_block);
+            CHECK_EQUAL(expect, n);
+            CHECK_EQUAL(0, strcmp(out, environ[0]));
+            allocator->deallocate(out);
+        }
+
+        UNITTEST_TEST(more_than_iov_max)
+        {
+            // every variable takes 3 iovecs, so this needs several writev calls
+            alloc_t*     allocator = context_t::system_alloc();
+            s32 const    count     = 2000;
+            char*        names     = (char*)allocator->allocate(count * 16);
+            char const** vars      = (char const**)allocator->allocate(count * sizeof(char const*));
+            for (s32 i = 0; i < count; ++i)
+            {
+                snprintf(names + i * 16, 16, "V%05d=%d", i, i);
+                vars[i] = names + i * 16;
+            }
+
+            uint_t const          bytes = env_snapshot_measure(vars, count);
+            void*                 mem   = allocator->allocate((u32)bytes, 8);
+            env_snapshot_t const* snap  = env_snapshot_build(mem, bytes, vars, count, env_snapshot_default);
+
+            uint_t expect = 0;
+            for (s32 i = 0; i < count; ++i)
+                expect += strlen(vars[i]) + 1;
+
+            char*        out = (char*)allocator->allocate((u32)expect + 1);
+            uint_t const n   = export_to(out, expect + 1, snap, env_export_block);
+            CHECK_EQUAL(expect, n);
+            CHECK_EQUAL(0, strcmp(out + expect - strlen(vars[count - 1]) - 1, vars[count - 1]));
+
+            allocator->deallocate(out);
+            allocator->deallocate(mem);
+            allocator->deallocate(vars);
+            allocator->deallocate(names);
+        }
+
+#endif
+    }
+}
+UNITTEST_SUITE_END
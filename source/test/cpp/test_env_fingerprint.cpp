@@ -0,0 +1,209 @@
+#include "cbase/c_allocator.h"
+#include "cbase/c_console.h"
+#include "cenv/c_env.h"
+#include "cenv/c_env_fingerprint.h"
+#include "cenv/c_env_guard.h"
+#include "cenv/test_bench.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+namespace
+{
+    // does the tracker agree with a fingerprint computed from scratch
+    bool matches(env_tracker_t* tracker, char const* const* names, uint_t count)
+    {
+        env_fingerprint_t fp;
+        return env_fingerprint(names, count, &fp) && fp == env_tracker_fingerprint(tracker);
+    }
+} // namespace
+
+UNITTEST_SUITE_BEGIN(test_env_fingerprint)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        static char const* s_names[] = {"CENV_FP_A", "CENV_FP_B", "CENV_FP_C"};
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            env_set("CENV_FP_A", "a");
+            env_set("CENV_FP_B", "b");
+            env_remove("CENV_FP_C");
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            env_remove("CENV_FP_A");
+            env_remove("CENV_FP_B");
+            env_remove("CENV_FP_C");
+            env_remove("CENV_FP_OTHER");
+        }
+
+        UNITTEST_TEST(order)
+        {
+            char const*       reversed[] = {"CENV_FP_C", "CENV_FP_B", "CENV_FP_A", "CENV_FP_B"};
+            env_fingerprint_t fp1, fp2;
+            CHECK_TRUE(env_fingerprint(s_names, 3, &fp1));
+            CHECK_TRUE(env_fingerprint(reversed, 4, &fp2));
+            CHECK_TRUE(fp1 == fp2);
+
+            // the value belongs to the name
+            env_set("CENV_FP_A", "b");
+            env_set("CENV_FP_B", "a");
+            CHECK_TRUE(env_fingerprint(s_names, 3, &fp2));
+            CHECK_TRUE(fp1 != fp2);
+
+            // an empty value is not a missing variable
+            env_set("CENV_FP_A", "a");
+            env_set("CENV_FP_B", "b");
+            env_set("CENV_FP_C", "");
+            CHECK_TRUE(env_fingerprint(s_names, 3, &fp2));
+            CHECK_TRUE(fp1 != fp2);
+        }
+
+        UNITTEST_TEST(subset)
+        {
+            env_tracker_t* tracker = env_tracker_create(s_names, 3);
+            CHECK_NOT_NULL(tracker);
+            CHECK_TRUE(matches(tracker, s_names, 3));
+            env_fingerprint_t const start = env_tracker_fingerprint(tracker);
+
+            env_set("CENV_FP_A", "changed");
+            CHECK_TRUE(matches(tracker, s_names, 3));
+            env_add("CENV_FP_B", "more", true);
+            CHECK_TRUE(matches(tracker, s_names, 3));
+            env_set("CENV_FP_C", "new");
+            CHECK_TRUE(matches(tracker, s_names, 3));
+            env_remove("CENV_FP_A");
+            CHECK_TRUE(matches(tracker, s_names, 3));
+
+            // a variable that is not tracked
+            env_fingerprint_t const before = env_tracker_fingerprint(tracker);
+            env_set("CENV_FP_OTHER", "x");
+            CHECK_TRUE(before == env_tracker_fingerprint(tracker));
+
+            // back where we started
+            env_set("CENV_FP_A", "a");
+            env_set("CENV_FP_B", "b");
+            env_remove("CENV_FP_C");
+            CHECK_TRUE(start == env_tracker_fingerprint(tracker));
+
+            env_tracker_destroy(tracker);
+        }
+
+        UNITTEST_TEST(whole)
+        {
+            env_tracker_t* tracker = env_tracker_create(null, 0);
+            CHECK_NOT_NULL(tracker);
+            CHECK_TRUE(matches(tracker, null, 0));
+
+            env_set("CENV_FP_OTHER", "x");
+            CHECK_TRUE(matches(tracker, null, 0));
+            env_set("CENV_FP_A", "changed");
+            CHECK_TRUE(matches(tracker, null, 0));
+            env_remove("CENV_FP_OTHER");
+            CHECK_TRUE(matches(tracker, null, 0));
+
+            env_tracker_destroy(tracker);
+        }
+
+        UNITTEST_TEST(guard_rollback)
+        {
+            env_tracker_t*          tracker = env_tracker_create(s_names, 3);
+            env_fingerprint_t const start   = env_tracker_fingerprint(tracker);
+
+            env_guard_t* guard = env_guard_begin();
+            env_set("CENV_FP_A", "changed");
+            env_set("CENV_FP_C", "new");
+            CHECK_TRUE(start != env_tracker_fingerprint(tracker));
+            env_guard_end(guard);
+
+            CHECK_TRUE(start == env_tracker_fingerprint(tracker));
+            CHECK_TRUE(matches(tracker, s_names, 3));
+
+            env_tracker_destroy(tracker);
+        }
+    }
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+    UNITTEST_FIXTURE(bench)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(recompute_vs_tracked)
+        {
+            if (!bench_enabled("fingerprint recompute_vs_tracked"))
+                return;
+
+            // a build action reads the key, once in a while a variable changes
+            char const* names[] = {"CC", "CXX", "CFLAGS", "CXXFLAGS", "LDFLAGS", "PATH", "SDKROOT", "CENV_FP_BENCH"};
+            const s32   loops   = 100000;
+            const s32   every   = 100;
+            char        value[32];
+
+            env_tracker_t*    tracker = env_tracker_create(names, 8);
+            env_fingerprint_t fp;
+            u64               sum = 0;
+
+            u64 t0 = bench_now_ns();
+            for (s32 i = 0; i < loops; ++i)
+            {
+                if (i % every == 0)
+                {
+                    snprintf(value, sizeof(value), "%d", i);
+                    env_set("CENV_FP_BENCH", value);
+                }
+                env_fingerprint(names, 8, &fp);
+                sum += fp.m_lo;
+            }
+            u64 t1 = bench_now_ns();
+            bench_report_op("subset, recompute", loops, t1 - t0);
+
+            t0 = bench_now_ns();
+            for (s32 i = 0; i < loops; ++i)
+            {
+                if (i % every == 0)
+                {
+                    snprintf(value, sizeof(value), "%d", i);
+                    env_set("CENV_FP_BENCH", value);
+                }
+                sum += env_tracker_fingerprint(tracker).m_lo;
+            }
+            t1 = bench_now_ns();
+            bench_report_op("subset, tracked", loops, t1 - t0);
+            env_tracker_destroy(tracker);
+
+            // the whole environment
+            const s32 whole = 1000;
+            tracker         = env_tracker_create(null, 0);
+            t0              = bench_now_ns();
+            for (s32 i = 0; i < whole; ++i)
+            {
+                env_fingerprint(null, 0, &fp);
+                sum += fp.m_lo;
+            }
+            t1 = bench_now_ns();
+            bench_report_op("whole environment, recompute", whole, t1 - t0);
+
+            t0 = bench_now_ns();
+            for (s32 i = 0; i < whole; ++i)
+                sum += env_tracker_fingerprint(tracker).m_lo;
+            t1 = bench_now_ns();
+            bench_report_op("whole environment, tracked", whole, t1 - t0);
+
+            CHECK_TRUE(matches(tracker, null, 0));
+            env_tracker_destroy(tracker);
+            env_remove("CENV_FP_BENCH");
+            CHECK_TRUE(sum != 0);
+        }
+    }
+
+#endif
+}
+UNITTEST_SUITE_END
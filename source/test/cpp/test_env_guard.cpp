@@ -0,0 +1,165 @@
+#include "cbase/c_allocator.h"
+#include "cenv/c_env.h"
+#include "cenv/c_env_guard.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+UNITTEST_SUITE_BEGIN(test_env_guard)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        static bool has_value(char const* name, char const* expected)
+        {
+            char value[256];
+            if (env_get(name, value, sizeof(value)) == 0)
+                return expected == null || expected[0] == '\0';
+            return expected && strcmp(value, expected) == 0;
+        }
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            env_set("CENV_GUARD_A", "a");
+            env_set("CENV_GUARD_B", "b");
+            env_remove("CENV_GUARD_C");
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            env_remove("CENV_GUARD_A");
+            env_remove("CENV_GUARD_B");
+            env_remove("CENV_GUARD_C");
+        }
+
+        UNITTEST_TEST(restore_on_end)
+        {
+            env_guard_t* guard = env_guard_begin();
+            env_set("CENV_GUARD_A", "changed");
+            env_set("CENV_GUARD_A", "changed twice");
+            env_remove("CENV_GUARD_B");
+            env_set("CENV_GUARD_C", "new");
+            CHECK_EQUAL(3, (s32)env_guard_size(guard));
+            CHECK_TRUE(has_value("CENV_GUARD_A", "changed twice"));
+            env_guard_end(guard);
+
+            CHECK_TRUE(has_value("CENV_GUARD_A", "a"));
+            CHECK_TRUE(has_value("CENV_GUARD_B", "b"));
+            CHECK_TRUE(has_value("CENV_GUARD_C", null));
+        }
+
+        UNITTEST_TEST(only_touched)
+        {
+            env_guard_t* guard = env_guard_begin();
+            CHECK_EQUAL(0, (s32)env_guard_size(guard));
+            env_add("CENV_GUARD_A", "x", true);
+            CHECK_EQUAL(1, (s32)env_guard_size(guard));
+
+            // a change that does not go through c_env.h is not ours to undo
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+            setenv("CENV_GUARD_B", "outside", 1);
+#endif
+            CHECK_EQUAL(1, (s32)env_guard_size(guard));
+            env_guard_end(guard);
+            CHECK_TRUE(has_value("CENV_GUARD_A", "a"));
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+            CHECK_TRUE(has_value("CENV_GUARD_B", "outside"));
+#else
+            CHECK_TRUE(has_value("CENV_GUARD_B", "b"));
+#endif
+        }
+
+#if defined(TARGET_OS_WINDOWS)
+        UNITTEST_TEST(case_insensitive)
+        {
+            // one variable, one record, the value from before the guard comes back
+            env_guard_t* guard = env_guard_begin();
+            env_set("cenv_guard_a", "lower");
+            env_set("CENV_GUARD_A", "upper");
+            CHECK_EQUAL(1, (s32)env_guard_size(guard));
+            env_guard_end(guard);
+            CHECK_TRUE(has_value("CENV_GUARD_A", "a"));
+        }
+#endif
+
+        UNITTEST_TEST(rollback)
+        {
+            env_scope_t scope;
+            env_set("CENV_GUARD_A", "1");
+            scope.rollback();
+            CHECK_EQUAL(0, (s32)scope.size());
+            CHECK_TRUE(has_value("CENV_GUARD_A", "a"));
+
+            // the guard is still active after a rollback
+            env_set("CENV_GUARD_B", "2");
+            CHECK_EQUAL(1, (s32)scope.size());
+        }
+
+        UNITTEST_TEST(scope)
+        {
+            {
+                env_scope_t scope;
+                env_set("CENV_GUARD_B", "scoped");
+                CHECK_TRUE(has_value("CENV_GUARD_B", "scoped"));
+            }
+            CHECK_TRUE(has_value("CENV_GUARD_B", "b"));
+        }
+
+        UNITTEST_TEST(null_guard)
+        {
+            // what a scope does when its guard could not begin
+            env_guard_rollback(null);
+            env_guard_end(null);
+            CHECK_EQUAL(0, (s32)env_guard_size(null));
+
+            // the guards that did begin are not affected
+            env_guard_t* guard = env_guard_begin();
+            env_guard_end(null);
+            env_set("CENV_GUARD_B", "x");
+            env_guard_end(guard);
+            CHECK_TRUE(has_value("CENV_GUARD_B", "b"));
+        }
+
+        UNITTEST_TEST(nested)
+        {
+            env_guard_t* outer = env_guard_begin();
+            env_set("CENV_GUARD_A", "outer");
+            {
+                env_guard_t* inner = env_guard_begin();
+                env_set("CENV_GUARD_A", "inner");
+                env_set("CENV_GUARD_C", "inner");
+                CHECK_EQUAL(2, (s32)env_guard_size(inner));
+                env_guard_end(inner);
+            }
+            CHECK_TRUE(has_value("CENV_GUARD_A", "outer"));
+            CHECK_TRUE(has_value("CENV_GUARD_C", null));
+            CHECK_EQUAL(1, (s32)env_guard_size(outer));
+            env_guard_end(outer);
+            CHECK_TRUE(has_value("CENV_GUARD_A", "a"));
+        }
+
+        UNITTEST_TEST(many)
+        {
+            char name[32];
+            {
+                env_scope_t scope;
+                for (s32 i = 0; i < 100; ++i)
+                {
+                    snprintf(name, sizeof(name), "CENV_GUARD_MANY_%d", i);
+                    env_set(name, "x");
+                }
+                CHECK_EQUAL(100, (s32)scope.size());
+            }
+            for (s32 i = 0; i < 100; ++i)
+            {
+                snprintf(name, sizeof(name), "CENV_GUARD_MANY_%d", i);
+                CHECK_TRUE(has_value(name, null));
+            }
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,264 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cenv/c_env_shm.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+#    include <sys/types.h>
+#    include <sys/wait.h>
+#    include <unistd.h>
+#endif
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+UNITTEST_SUITE_BEGIN(test_env_shm)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+        UNITTEST_TEST(publish_and_find)
+        {
+            env_shm_t* shm = env_shm_create(4096, env_snapshot_default);
+            CHECK_NOT_NULL(shm);
+            CHECK_EQUAL(0, (s32)env_shm_version(shm));
+
+            env_shm_reader_t reader;
+            env_shm_reader_init(&reader, shm);
+
+            env_view_t value;
+            CHECK_FALSE(env_shm_find(&reader, "LEVEL", &value));
+
+            char const* v1[] = {"LEVEL=info", "MODE=fast"};
+            CHECK_EQUAL(1, (s32)env_shm_publish(shm, v1, 2));
+            CHECK_TRUE(env_shm_refresh(&reader));
+            CHECK_FALSE(env_shm_refresh(&reader));
+            CHECK_TRUE(env_shm_find(&reader, "LEVEL", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "info"));
+
+            // one version later the views are still intact
+            char const* v2[] = {"LEVEL=debug"};
+            CHECK_EQUAL(2, (s32)env_shm_publish(shm, v2, 1));
+            CHECK_TRUE(env_shm_valid(&reader));
+            CHECK_EQUAL(0, strcmp(value.m_str, "info"));
+
+            // two versions later the buffer of the reader has been reused
+            CHECK_EQUAL(3, (s32)env_shm_publish(shm, v1, 1));
+            CHECK_FALSE(env_shm_valid(&reader));
+            CHECK_TRUE(env_shm_find(&reader, "LEVEL", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "info"));
+            CHECK_EQUAL(3, (s32)reader.m_version);
+            CHECK_FALSE(env_shm_find(&reader, "MODE", &value));
+
+            env_shm_close(shm);
+        }
+
+        UNITTEST_TEST(too_large)
+        {
+            env_shm_t*  shm = env_shm_create(64, env_snapshot_default);
+            char const* v[] = {"A=0123456789012345678901234567890123456789", "B=0123456789012345678901234567890123456789"};
+            CHECK_EQUAL(0, (s32)env_shm_publish(shm, v, 2));
+            CHECK_EQUAL(0, (s32)env_shm_version(shm));
+            env_shm_close(shm);
+        }
+
+        UNITTEST_TEST(forked_workers)
+        {
+            env_shm_t*  shm  = env_shm_create(4096, env_snapshot_default);
+            char const* v1[] = {"LEVEL=info"};
+            env_shm_publish(shm, v1, 1);
+
+            // the workers start on version 1 or 2 and wait until they see version 2
+            pid_t workers[4];
+            for (s32 i = 0; i < 4; ++i)
+            {
+                workers[i] = fork();
+                if (workers[i] == 0)
+                {
+                    env_shm_reader_t reader;
+                    env_shm_reader_init(&reader, shm);
+
+                    env_view_t value;
+                    if (!env_shm_find(&reader, "LEVEL", &value))
+                        _exit(1);
+                    if (reader.m_version == 1 && strcmp(value.m_str, "info") != 0)
+                        _exit(1);
+                    while (reader.m_version != 2)
+                    {
+                        usleep(100);
+                        env_shm_refresh(&reader);
+                    }
+                    if (!env_shm_find(&reader, "LEVEL", &value) || strcmp(value.m_str, "debug") != 0)
+                        _exit(2);
+                    _exit(0);
+                }
+            }
+
+            char const* v2[] = {"LEVEL=debug"};
+            env_shm_publish(shm, v2, 1);
+
+            for (s32 i = 0; i < 4; ++i)
+            {
+                int status = -1;
+                CHECK_EQUAL(workers[i], waitpid(workers[i], &status, 0));
+                CHECK_TRUE(WIFEXITED(status));
+                CHECK_EQUAL(0, WEXITSTATUS(status));
+            }
+
+            env_shm_close(shm);
+        }
+
+        // the value of KEY in version v is v as 8 digits, 4 times, a torn read breaks the pattern
+        static void torn_value(char* dst, u32 v) { snprintf(dst, 40, "%08u%08u%08u%08u", v, v, v, v); }
+
+        static s32 torn_reader(env_shm_t* shm, int ready)
+        {
+            env_shm_reader_t reader;
+            env_shm_reader_init(&reader, shm);
+
+            u32        last = 0;
+            env_view_t value;
+            while (true)
+            {
+                env_shm_refresh(&reader);
+                if (env_shm_find(&reader, "DONE", &value))
+                    return last > 0 ? 0 : 4;
+
+                // every version but the last has the key, a lookup that races with the publisher
+                // retries inside and may move on to the last version
+                if (!env_shm_find(&reader, "KEY", &value))
+                    return env_shm_find(&reader, "DONE", &value) ? 0 : 1;
+
+                // the copy is only trusted when the buffer was not reused while it was made
+                char copy[40];
+                if (value.m_len != 32)
+                {
+                    if (env_shm_valid(&reader))
+                        return 2;
+                    continue;
+                }
+                memcpy(copy, value.m_str, 32);
+                copy[32] = '\0';
+                if (!env_shm_valid(&reader))
+                    continue;
+
+                char expect[40];
+                u32  v = 0;
+                sscanf(copy, "%8u", &v);
+                torn_value(expect, v);
+                if (strcmp(copy, expect) != 0)
+                    return 2;
+                if (v < last)
+                    return 3;
+
+                // tell the publisher that this reader is running
+                if (last == 0 && write(ready, "r", 1) != 1)
+                    return 5;
+                last = v;
+            }
+        }
+
+        UNITTEST_TEST(torn_reads)
+        {
+            env_shm_t* shm = env_shm_create(4096, env_snapshot_default);
+
+            // a different number of fillers per version moves the key around in the buffer
+            char        fill[8][16];
+            char        key[40 + 4];
+            char const* vars[10];
+            for (s32 i = 0; i < 8; ++i)
+                snprintf(fill[i], sizeof(fill[i]), "A_FILL_%d=%d", i, i);
+
+            memcpy(key, "KEY=", 4);
+            torn_value(key + 4, 1);
+            vars[0] = key;
+            env_shm_publish(shm, vars, 1);
+
+            int ready[2];
+            CHECK_EQUAL(0, pipe(ready));
+
+            pid_t readers[4];
+            for (s32 i = 0; i < 4; ++i)
+            {
+                readers[i] = fork();
+                if (readers[i] == 0)
+                    _exit(torn_reader(shm, ready[1]));
+            }
+
+            // every reader has found version 1
+            char byte;
+            for (s32 i = 0; i < 4; ++i)
+                CHECK_EQUAL(1, (s32)read(ready[0], &byte, 1));
+            close(ready[0]);
+            close(ready[1]);
+
+            // publish as fast as we can while the readers look up the key
+            for (u32 v = 2; v <= 20000; ++v)
+            {
+                u32 const fillers = v % 9;
+                for (u32 i = 0; i < fillers; ++i)
+                    vars[i] = fill[i];
+                torn_value(key + 4, v);
+                vars[fillers] = key;
+                CHECK_EQUAL((s32)v, (s32)env_shm_publish(shm, vars, fillers + 1));
+            }
+            char const* done[] = {"DONE=1"};
+            env_shm_publish(shm, done, 1);
+
+            for (s32 i = 0; i < 4; ++i)
+            {
+                int status = -1;
+                CHECK_EQUAL(readers[i], waitpid(readers[i], &status, 0));
+                CHECK_TRUE(WIFEXITED(status));
+                CHECK_EQUAL(0, WEXITSTATUS(status));
+            }
+
+            env_shm_close(shm);
+        }
+
+        UNITTEST_TEST(attach)
+        {
+            env_shm_t*  shm = env_shm_create(4096, env_snapshot_default);
+            char const* v[] = {"LEVEL=warn"};
+            env_shm_publish(shm, v, 1);
+
+            // an exec'ed worker gets the descriptor, here we duplicate it
+            env_shm_t* view = env_shm_attach(dup(env_shm_fd(shm)));
+            CHECK_NOT_NULL(view);
+            CHECK_EQUAL(1, (s32)env_shm_version(view));
+
+            env_shm_reader_t reader;
+            env_shm_reader_init(&reader, view);
+            env_view_t value;
+            CHECK_TRUE(env_shm_find(&reader, "LEVEL", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "warn"));
+
+            env_shm_close(view);
+            env_shm_close(shm);
+        }
+
+        UNITTEST_TEST(case_insensitive)
+        {
+            env_shm_t*  shm = env_shm_create(4096, env_snapshot_case_insensitive);
+            char const* v[] = {"Path=/bin"};
+            env_shm_publish(shm, v, 1);
+
+            env_shm_reader_t reader;
+            env_shm_reader_init(&reader, shm);
+            env_view_t value;
+            CHECK_TRUE(env_shm_find(&reader, "PATH", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "/bin"));
+            env_shm_close(shm);
+        }
+
+#endif
+    }
+}
+UNITTEST_SUITE_END
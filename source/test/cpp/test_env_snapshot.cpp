@@ -0,0 +1,265 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_console.h"
+#include "cenv/c_env_snapshot.h"
+#include "cenv/test_bench.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+UNITTEST_SUITE_BEGIN(test_env_snapshot)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        static char const* s_vars[] = {"PATH=/usr/bin:/bin", "HOME=/home/user", "EMPTY=", "NOVALUE", "=C:=C:\\", "HOME=/duplicate", "APP_DB_HOST=localhost"};
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(build_and_find)
+        {
+            u64 mem[256];
+            CHECK_TRUE(env_snapshot_measure(s_vars, 7) <= sizeof(mem));
+
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 7, env_snapshot_default);
+            CHECK_NOT_NULL(snap);
+            CHECK_EQUAL(4, (s32)env_snapshot_size(snap));
+
+            env_view_t value;
+            CHECK_TRUE(env_snapshot_find(snap, "PATH", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "/usr/bin:/bin"));
+            CHECK_TRUE(env_snapshot_find(snap, "HOME", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "/home/user"));
+            CHECK_TRUE(env_snapshot_find(snap, "EMPTY", &value));
+            CHECK_EQUAL(0, (s32)value.m_len);
+            CHECK_FALSE(env_snapshot_find(snap, "NOVALUE", &value));
+            CHECK_FALSE(env_snapshot_find(snap, "PAT", &value));
+        }
+
+        UNITTEST_TEST(sorted)
+        {
+            u64                   mem[256];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 7, env_snapshot_default);
+
+            env_view_t name, prev;
+            CHECK_TRUE(env_snapshot_at(snap, 0, &prev, null));
+            for (uint_t i = 1; i < env_snapshot_size(snap); ++i)
+            {
+                CHECK_TRUE(env_snapshot_at(snap, i, &name, null));
+                CHECK_TRUE(strcmp(prev.m_str, name.m_str) < 0);
+                prev = name;
+            }
+            CHECK_FALSE(env_snapshot_at(snap, env_snapshot_size(snap), &name, null));
+        }
+
+        UNITTEST_TEST(too_small)
+        {
+            u64 mem[4];
+            CHECK_NULL(env_snapshot_build(mem, sizeof(mem), s_vars, 7, env_snapshot_default));
+        }
+
+        UNITTEST_TEST(prefix)
+        {
+            static char const* vars[] = {"OTEL_B=2", "APP_DB_HOST=h", "OTEL_A=1", "OTE=0", "OTEL=x", "APP_DB_PORT=5432", "PATH=/bin", "OTELX=3"};
+
+            u64                   mem[256];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), vars, 8, env_snapshot_default);
+
+            uint_t     first, end;
+            env_view_t name;
+            CHECK_TRUE(env_snapshot_prefix(snap, "OTEL_", &first, &end));
+            CHECK_EQUAL(2, (s32)(end - first));
+            env_snapshot_at(snap, first, &name, null);
+            CHECK_EQUAL(0, strcmp(name.m_str, "OTEL_A"));
+            env_snapshot_at(snap, first + 1, &name, null);
+            CHECK_EQUAL(0, strcmp(name.m_str, "OTEL_B"));
+
+            CHECK_TRUE(env_snapshot_prefix(snap, "OTEL", &first, &end));
+            CHECK_EQUAL(4, (s32)(end - first));
+            CHECK_TRUE(env_snapshot_prefix(snap, "APP_DB_", &first, &end));
+            CHECK_EQUAL(2, (s32)(end - first));
+            CHECK_TRUE(env_snapshot_prefix(snap, "", &first, &end));
+            CHECK_EQUAL(8, (s32)(end - first));
+            CHECK_FALSE(env_snapshot_prefix(snap, "ZZZ", &first, &end));
+            CHECK_FALSE(env_snapshot_prefix(snap, "APP_DB_HOSTS", &first, &end));
+        }
+
+        UNITTEST_TEST(case_insensitive)
+        {
+            static char const* vars[] = {"Path=/bin", "windir=C:\\Windows", "PATH=/duplicate", "ProgramFiles=C:\\Program Files", "PROGRAMDATA=C:\\ProgramData", "A@[Z=1", "a`{z=2", "\xC1=3"};
+
+            u64                   mem[256];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), vars, 8, env_snapshot_case_insensitive);
+            CHECK_NOT_NULL(snap);
+            CHECK_EQUAL(7, (s32)env_snapshot_size(snap));
+
+            // the first name wins and keeps its case
+            env_view_t name, value;
+            CHECK_TRUE(env_snapshot_find(snap, "PATH", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "/bin"));
+            CHECK_TRUE(env_snapshot_find(snap, "path", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "/bin"));
+            CHECK_TRUE(env_snapshot_find(snap, "WinDir", &value));
+            CHECK_TRUE(env_snapshot_find(snap, "PROGRAMFILES", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "C:\\Program Files"));
+            CHECK_FALSE(env_snapshot_find(snap, "PROGRAMFILE", &value));
+
+            // only the ASCII letters fold
+            CHECK_TRUE(env_snapshot_find(snap, "a@[z", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "1"));
+            CHECK_TRUE(env_snapshot_find(snap, "A`{Z", &value));
+            CHECK_EQUAL(0, strcmp(value.m_str, "2"));
+            CHECK_FALSE(env_snapshot_find(snap, "\xE1", &value));
+            CHECK_TRUE(env_snapshot_find(snap, "\xC1", &value));
+
+            bool path = false;
+            for (uint_t i = 0; i < env_snapshot_size(snap); ++i)
+            {
+                env_snapshot_at(snap, i, &name, null);
+                path = path || strcmp(name.m_str, "Path") == 0;
+            }
+            CHECK_TRUE(path);
+
+            // the matches of a prefix are adjacent whatever their case
+            uint_t first, end;
+            CHECK_TRUE(env_snapshot_prefix(snap, "program", &first, &end));
+            CHECK_EQUAL(2, (s32)(end - first));
+            env_snapshot_at(snap, first, &name, null);
+            CHECK_EQUAL(0, strcmp(name.m_str, "PROGRAMDATA"));
+            env_snapshot_at(snap, first + 1, &name, null);
+            CHECK_EQUAL(0, strcmp(name.m_str, "ProgramFiles"));
+
+            // the default is case-sensitive
+            snap = env_snapshot_build(mem, sizeof(mem), vars, 8, env_snapshot_default);
+            CHECK_EQUAL(8, (s32)env_snapshot_size(snap));
+            CHECK_FALSE(env_snapshot_find(snap, "path", &value));
+        }
+
+        UNITTEST_TEST(case_insensitive_lengths)
+        {
+            // the names are hashed and compared in overlapping words, every length and position counts
+            for (s32 len = 1; len <= 40; ++len)
+            {
+                char var[48];
+                char name[48];
+                for (s32 i = 0; i < len; ++i)
+                {
+                    var[i]  = (char)('A' + (i * 7) % 26);
+                    name[i] = (char)(var[i] | 0x20);
+                }
+                var[len]     = '=';
+                var[len + 1] = '\0';
+                name[len]    = '\0';
+
+                u64                   mem[32];
+                char const*           vars[] = {var};
+                env_snapshot_t const* snap   = env_snapshot_build(mem, sizeof(mem), vars, 1, env_snapshot_case_insensitive);
+                env_view_t            value;
+                CHECK_TRUE(env_snapshot_find(snap, name, &value));
+                for (s32 i = 0; i < len; ++i)
+                {
+                    char const c = name[i];
+                    name[i]      = c == 'z' ? 'y' : (char)(c + 1);
+                    CHECK_FALSE(env_snapshot_find(snap, name, &value));
+                    name[i] = c;
+                }
+            }
+        }
+
+        UNITTEST_TEST(live)
+        {
+            env_snapshot_t* snap = env_snapshot_create(env_snapshot_default);
+            CHECK_NOT_NULL(snap);
+
+            // the image is position independent
+            u64* copy = (u64*)context_t::system_alloc()->allocate((u32)env_snapshot_bytes(snap), 8);
+            memcpy(copy, snap, env_snapshot_bytes(snap));
+            CHECK_EQUAL(env_snapshot_size(snap), env_snapshot_size((env_snapshot_t const*)copy));
+
+            env_view_t name, a, b;
+            for (uint_t i = 0; i < env_snapshot_size(snap); ++i)
+            {
+                CHECK_TRUE(env_snapshot_at(snap, i, &name, &a));
+                CHECK_TRUE(env_snapshot_find((env_snapshot_t const*)copy, name.m_str, &b));
+                CHECK_EQUAL(0, strcmp(a.m_str, b.m_str));
+            }
+
+            context_t::system_alloc()->deallocate(copy);
+            env_snapshot_destroy(snap);
+        }
+    }
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+    UNITTEST_FIXTURE(bench)
+    {
+        static u64 run(env_snapshot_t const* snap, char const* const* names, s32 count, s32 loops)
+        {
+            env_view_t value;
+            s32        found = 0;
+            u64 const  t0    = bench_now_ns();
+            for (s32 l = 0; l < loops; ++l)
+            {
+                for (s32 i = 0; i < count; ++i)
+                    found += env_snapshot_find(snap, names[i], &value) ? 1 : 0;
+            }
+            u64 const t1 = bench_now_ns();
+            CHECK_EQUAL(count * loops, found);
+            return t1 - t0;
+        }
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(case_insensitive_find)
+        {
+            if (!bench_enabled("snapshot case_insensitive_find"))
+                return;
+
+            // names of typical length, looked up with the case they were stored with and in lower case
+            const s32   count = 64;
+            const s32   loops = 2000;
+            char        vars[count][64];
+            char        names[count][48];
+            char        lower[count][48];
+            char const* pvars[count];
+            char const* pnames[count];
+            char const* plower[count];
+            for (s32 i = 0; i < count; ++i)
+            {
+                snprintf(names[i], sizeof(names[i]), "CENV_BENCH_%s_VARIABLE_%d", (i & 1) ? "Build" : "RUNTIME", i);
+                snprintf(vars[i], sizeof(vars[i]), "%s=%d", names[i], i);
+                for (s32 j = 0; j < 48; ++j)
+                    lower[i][j] = (names[i][j] >= 'A' && names[i][j] <= 'Z') ? (char)(names[i][j] | 0x20) : names[i][j];
+                pvars[i]  = vars[i];
+                pnames[i] = names[i];
+                plower[i] = lower[i];
+            }
+
+            alloc_t*              allocator = context_t::system_alloc();
+            uint_t const          bytes     = env_snapshot_measure(pvars, count);
+            void*                 mem1      = allocator->allocate((u32)bytes, 8);
+            void*                 mem2      = allocator->allocate((u32)bytes, 8);
+            env_snapshot_t const* exact     = env_snapshot_build(mem1, bytes, pvars, count, env_snapshot_default);
+            env_snapshot_t const* fold      = env_snapshot_build(mem2, bytes, pvars, count, env_snapshot_case_insensitive);
+
+            u64 const ns_exact = run(exact, pnames, count, loops);
+            u64 const ns_fold  = run(fold, pnames, count, loops);
+            u64 const ns_lower = run(fold, plower, count, loops);
+
+            bench_report_op("find, case-sensitive", count * loops, ns_exact);
+            bench_report_op("find, case-insensitive", count * loops, ns_fold);
+            bench_report_op("find, case-insensitive, lower case", count * loops, ns_lower);
+
+            allocator->deallocate(mem2);
+            allocator->deallocate(mem1);
+        }
+    }
+
+#endif
+}
+UNITTEST_SUITE_END
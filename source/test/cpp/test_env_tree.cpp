@@ -0,0 +1,182 @@
+#include "cbase/c_allocator.h"
+#include "cenv/c_env_tree.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+UNITTEST_SUITE_BEGIN(test_env_tree)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        static char const* s_vars[] = {"APP__CACHE__SIZE=64", "APP__NAME=demo", "APP__CACHE=on", "APP_X=skip", "APP__CACHE__TTL=10", "OTHER=1", "APP__=root"};
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(build)
+        {
+            u64                   mem[256];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 7, env_snapshot_default);
+
+            env_tree_t* tree = env_tree_build(snap, "APP__", "__");
+            CHECK_NOT_NULL(tree);
+
+            env_node_t const* root = env_tree_root(tree);
+            CHECK_EQUAL(5, (s32)root->m_key.m_len);
+            CHECK_EQUAL(0, strcmp(root->m_value.m_str, "root"));
+
+            env_node_t const* cache = env_tree_child(root, "CACHE");
+            CHECK_NOT_NULL(cache);
+            CHECK_EQUAL(0, strcmp(cache->m_value.m_str, "on"));
+
+            env_node_t const* size = env_tree_child(cache, "SIZE");
+            CHECK_NOT_NULL(size);
+            CHECK_EQUAL(0, strcmp(size->m_value.m_str, "64"));
+            CHECK_NULL(size->m_child);
+
+            env_node_t const* ttl = env_tree_child(cache, "TTL");
+            CHECK_NOT_NULL(ttl);
+            CHECK_EQUAL(0, strcmp(ttl->m_value.m_str, "10"));
+
+            env_node_t const* name = env_tree_child(root, "NAME");
+            CHECK_NOT_NULL(name);
+            CHECK_EQUAL(0, strcmp(name->m_value.m_str, "demo"));
+
+            CHECK_NULL(env_tree_child(root, "X"));
+            CHECK_NULL(env_tree_child(root, "SIZE"));
+
+            env_tree_destroy(tree);
+        }
+
+        UNITTEST_TEST(intermediate_nodes)
+        {
+            static char const* vars[] = {"A__B__C=1", "A__B__D=2"};
+
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), vars, 2, env_snapshot_default);
+            env_tree_t*           tree = env_tree_build(snap, "", "__");
+
+            env_node_t const* a = env_tree_child(env_tree_root(tree), "A");
+            CHECK_NOT_NULL(a);
+            CHECK_NULL(a->m_value.m_str);
+            env_node_t const* b = env_tree_child(a, "B");
+            CHECK_NOT_NULL(b);
+            CHECK_NULL(b->m_value.m_str);
+            CHECK_NOT_NULL(env_tree_child(b, "C"));
+            CHECK_NOT_NULL(env_tree_child(b, "D"));
+
+            env_tree_destroy(tree);
+        }
+
+        UNITTEST_TEST(no_match)
+        {
+            u64                   mem[256];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), s_vars, 7, env_snapshot_default);
+            env_tree_t*           tree = env_tree_build(snap, "NOPE_", "__");
+            CHECK_NOT_NULL(tree);
+            CHECK_NULL(env_tree_root(tree)->m_child);
+            env_tree_destroy(tree);
+        }
+
+        static bool key_less(env_view_t const& a, env_view_t const& b)
+        {
+            s32 const c = memcmp(a.m_str, b.m_str, a.m_len < b.m_len ? a.m_len : b.m_len);
+            return c < 0 || (c == 0 && a.m_len < b.m_len);
+        }
+
+        UNITTEST_TEST(key_comes_back)
+        {
+            // the names sort as "A", "A0", "A__B", the key A comes back after its sibling
+            static char const* vars[] = {"A__B=3", "A0=2", "A=1"};
+
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), vars, 3, env_snapshot_default);
+            env_tree_t*           tree = env_tree_build(snap, "", "__");
+
+            env_node_t const* root = env_tree_root(tree);
+            CHECK_EQUAL(2, (s32)root->m_child_count);
+            env_node_t const* a = env_tree_child(root, "A");
+            CHECK_NOT_NULL(a);
+            CHECK_EQUAL(0, strcmp(a->m_value.m_str, "1"));
+            CHECK_EQUAL(0, strcmp(env_tree_child(a, "B")->m_value.m_str, "3"));
+            CHECK_EQUAL(0, strcmp(env_tree_child(root, "A0")->m_value.m_str, "2"));
+            env_tree_destroy(tree);
+        }
+
+        UNITTEST_TEST(wide)
+        {
+            // a flat namespace, the children are ordered and found by binary search
+            const s32   count = 300;
+            char        vars[count][32];
+            char const* pvars[count];
+            for (s32 i = 0; i < count; ++i)
+            {
+                snprintf(vars[i], sizeof(vars[i]), "N__K%d=%d", (i * 7919) % count, i);
+                pvars[i] = vars[i];
+            }
+
+            alloc_t*              allocator = context_t::system_alloc();
+            uint_t const          bytes     = env_snapshot_measure(pvars, count);
+            void*                 mem       = allocator->allocate((u32)bytes, 8);
+            env_snapshot_t const* snap      = env_snapshot_build(mem, bytes, pvars, count, env_snapshot_default);
+            env_tree_t*           tree      = env_tree_build(snap, "N__", "__");
+
+            env_node_t const* root = env_tree_root(tree);
+            CHECK_EQUAL(count, (s32)root->m_child_count);
+            s32 linked = 0;
+            for (env_node_t const* child = root->m_child; child; child = child->m_next)
+            {
+                CHECK_TRUE(child == root->m_child + linked);
+                if (linked > 0)
+                    CHECK_TRUE(key_less(child[-1].m_key, child->m_key));
+                linked++;
+            }
+            CHECK_EQUAL(count, linked);
+
+            char key[16];
+            for (s32 i = 0; i < count; ++i)
+            {
+                snprintf(key, sizeof(key), "K%d", i);
+                env_node_t const* child = env_tree_child(root, key);
+                CHECK_NOT_NULL(child);
+                CHECK_EQUAL((s32)strlen(key), (s32)child->m_key.m_len);
+            }
+            CHECK_NULL(env_tree_child(root, "K"));
+            CHECK_NULL(env_tree_child(root, "K300"));
+
+            env_tree_destroy(tree);
+            allocator->deallocate(mem);
+        }
+
+        UNITTEST_TEST(case_insensitive)
+        {
+            static char const* vars[] = {"APP__Cache__SIZE=64", "app__CACHE__TTL=10"};
+
+            u64                   mem[128];
+            env_snapshot_t const* snap = env_snapshot_build(mem, sizeof(mem), vars, 2, env_snapshot_case_insensitive);
+            env_tree_t*           tree = env_tree_build(snap, "App__", "__");
+            CHECK_NOT_NULL(tree);
+
+            // one node for both spellings of the key
+            env_node_t const* root  = env_tree_root(tree);
+            env_node_t const* cache = env_tree_child(root, "cache");
+            CHECK_NOT_NULL(cache);
+            CHECK_NULL(cache->m_next);
+            CHECK_EQUAL(0, strcmp(env_tree_child(cache, "size")->m_value.m_str, "64"));
+            CHECK_EQUAL(0, strcmp(env_tree_child(cache, "Ttl")->m_value.m_str, "10"));
+            env_tree_destroy(tree);
+
+            // exact keys when the snapshot is case-sensitive
+            snap = env_snapshot_build(mem, sizeof(mem), vars, 2, env_snapshot_default);
+            tree = env_tree_build(snap, "APP__", "__");
+            CHECK_NULL(env_tree_child(env_tree_root(tree), "cache"));
+            CHECK_NOT_NULL(env_tree_child(env_tree_root(tree), "Cache"));
+            env_tree_destroy(tree);
+        }
+    }
+}
+UNITTEST_SUITE_END
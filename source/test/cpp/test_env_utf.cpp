@@ -0,0 +1,358 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_console.h"
+#include "cenv/c_env_utf.h"
+#include "cenv/test_bench.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+namespace
+{
+    // a straightforward code point at a time reference
+    uint_t ref_utf8_to_utf16(char const* str, uint_t len, u16* dst)
+    {
+        u8 const* s = (u8 const*)str;
+        uint_t    n = 0;
+        for (uint_t i = 0; i < len;)
+        {
+            u32 cp;
+            if (s[i] < 0x80)
+                cp = s[i++];
+            else if (s[i] < 0xE0)
+            {
+                cp = ((u32)(s[i] & 0x1F) << 6) | (s[i + 1] & 0x3F);
+                i += 2;
+            }
+            else if (s[i] < 0xF0)
+            {
+                cp = ((u32)(s[i] & 0x0F) << 12) | ((u32)(s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+                i += 3;
+            }
+            else
+            {
+                cp = ((u32)(s[i] & 0x07) << 18) | ((u32)(s[i + 1] & 0x3F) << 12) | ((u32)(s[i + 2] & 0x3F) << 6) | (s[i + 3] & 0x3F);
+                i += 4;
+            }
+            if (cp >= 0x10000)
+            {
+                dst[n++] = (u16)(0xD800 | ((cp - 0x10000) >> 10));
+                dst[n++] = (u16)(0xDC00 | ((cp - 0x10000) & 0x3FF));
+            }
+            else
+                dst[n++] = (u16)cp;
+        }
+        return n;
+    }
+
+    // a straightforward validator, the table 3-7 of the unicode standard
+    bool ref_valid(char const* str, uint_t len)
+    {
+        u8 const* s = (u8 const*)str;
+        for (uint_t i = 0; i < len;)
+        {
+            u8 const c = s[i];
+            u8       lo = 0x80, hi = 0xBF;
+            uint_t   n;
+            if (c < 0x80)
+                n = 1;
+            else if (c >= 0xC2 && c <= 0xDF)
+                n = 2;
+            else if (c >= 0xE0 && c <= 0xEF)
+            {
+                n  = 3;
+                lo = c == 0xE0 ? 0xA0 : 0x80;
+                hi = c == 0xED ? 0x9F : 0xBF;
+            }
+            else if (c >= 0xF0 && c <= 0xF4)
+            {
+                n  = 4;
+                lo = c == 0xF0 ? 0x90 : 0x80;
+                hi = c == 0xF4 ? 0x8F : 0xBF;
+            }
+            else
+                return false;
+            if (i + n > len)
+                return false;
+            for (uint_t j = 1; j < n; ++j)
+            {
+                if (s[i + j] < (j == 1 ? lo : 0x80) || s[i + j] > (j == 1 ? hi : 0xBF))
+                    return false;
+            }
+            i += n;
+        }
+        return true;
+    }
+
+    u32 s_seed = 12345;
+    u32 next_random()
+    {
+        s_seed = s_seed * 1664525 + 1013904223;
+        return s_seed >> 8;
+    }
+
+    // a random valid utf-8 string, mostly ascii with the occasional 2, 3 and 4 byte sequence
+    uint_t make_text(char* buffer, uint_t len, u32 non_ascii_per_256)
+    {
+        u8*    dst = (u8*)buffer;
+        uint_t n   = 0;
+        while (n + 4 <= len)
+        {
+            u32 const r = next_random();
+            if ((r & 0xFF) >= non_ascii_per_256)
+            {
+                dst[n++] = (u8)(0x20 + (r >> 8) % 0x5F);
+                continue;
+            }
+            u32 cp;
+            switch ((r >> 8) % 3)
+            {
+                case 0: cp = 0x80 + (r >> 10) % (0x800 - 0x80); break;
+                case 1: cp = 0x800 + (r >> 10) % (0xD800 - 0x800); break;
+                default: cp = 0x10000 + (r >> 10) % 0x100000; break;
+            }
+            if (cp < 0x800)
+            {
+                dst[n++] = (u8)(0xC0 | (cp >> 6));
+                dst[n++] = (u8)(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000)
+            {
+                dst[n++] = (u8)(0xE0 | (cp >> 12));
+                dst[n++] = (u8)(0x80 | ((cp >> 6) & 0x3F));
+                dst[n++] = (u8)(0x80 | (cp & 0x3F));
+            }
+            else
+            {
+                dst[n++] = (u8)(0xF0 | (cp >> 18));
+                dst[n++] = (u8)(0x80 | ((cp >> 12) & 0x3F));
+                dst[n++] = (u8)(0x80 | ((cp >> 6) & 0x3F));
+                dst[n++] = (u8)(0x80 | (cp & 0x3F));
+            }
+        }
+        return n;
+    }
+
+    bool roundtrip(char const* str, uint_t len)
+    {
+        u16  wide[512];
+        char back[1024];
+
+        uint_t const units = env_utf8_to_utf16_len(str, len);
+        if (units == env_utf_invalid || units > 512)
+            return false;
+        if (env_utf8_to_utf16(str, len, wide) != units)
+            return false;
+
+        u16 ref[512];
+        if (ref_utf8_to_utf16(str, len, ref) != units || memcmp(ref, wide, units * sizeof(u16)) != 0)
+            return false;
+
+        uint_t const bytes = env_utf16_to_utf8_len(wide, units);
+        if (bytes != len)
+            return false;
+        if (env_utf16_to_utf8(wide, units, back) != len)
+            return false;
+        return memcmp(back, str, len) == 0;
+    }
+} // namespace
+
+UNITTEST_SUITE_BEGIN(test_env_utf)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(ascii)
+        {
+            char const* str = "PATH=/usr/local/bin:/usr/bin:/bin:/usr/local/games:/usr/games";
+            CHECK_EQUAL(strlen(str), env_utf8_to_utf16_len(str, strlen(str)));
+            CHECK_TRUE(roundtrip(str, strlen(str)));
+            CHECK_TRUE(roundtrip("", 0));
+            CHECK_TRUE(roundtrip("a", 1));
+        }
+
+        UNITTEST_TEST(multi_byte)
+        {
+            // U+00E9, U+20AC, U+1F600
+            char const* str = "caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80";
+            CHECK_EQUAL(9, (s32)env_utf8_to_utf16_len(str, strlen(str)));
+
+            u16 wide[16];
+            env_utf8_to_utf16(str, strlen(str), wide);
+            CHECK_EQUAL(0xE9, wide[3]);
+            CHECK_EQUAL(0x20AC, wide[5]);
+            CHECK_EQUAL(0xD83D, wide[7]);
+            CHECK_EQUAL(0xDE00, wide[8]);
+            CHECK_TRUE(roundtrip(str, strlen(str)));
+        }
+
+        UNITTEST_TEST(invalid_utf8)
+        {
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("\x80", 1));             // lone continuation
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("\xC0\xAF", 2));         // overlong
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("\xE0\x80\xAF", 3));     // overlong
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("\xED\xA0\x80", 3));     // surrogate
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("\xF4\x90\x80\x80", 4)); // above U+10FFFF
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("abc\xE2\x82", 5));      // truncated
+            CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len("0123456789abcdef0123\xFF", 21));
+        }
+
+        UNITTEST_TEST(invalid_in_block)
+        {
+            // every invalid sequence at every offset of the blocks, between multi byte text
+            static char const* bad[] = {"\x80", "\xC0\xAF", "\xC1\xBF", "\xC3", "\xC3\xC3", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xE2\x82", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF"};
+            char                text[64];
+            u16                 wide[64];
+            for (uint_t b = 0; b < sizeof(bad) / sizeof(bad[0]); ++b)
+            {
+                uint_t const n = strlen(bad[b]);
+                for (uint_t at = 0; at + n <= 48; ++at)
+                {
+                    for (uint_t i = 0; i < sizeof(text); ++i)
+                        text[i] = (i % 5 == 0) ? 'x' : 'a' + (char)(i % 26);
+                    memcpy(text + 2, "\xC3\xA9", 2);
+                    memcpy(text + 50, "\xE2\x82\xAC", 3);
+                    memcpy(text + at, bad[b], n);
+                    if (ref_valid(text, sizeof(text)))
+                        continue;
+                    CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16_len(text, sizeof(text)));
+                    CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16(text, sizeof(text), wide));
+                }
+            }
+        }
+
+        UNITTEST_TEST(mutated)
+        {
+            // valid text with one byte changed, the transcoder agrees with the reference validator
+            char text[200];
+            u16  wide[200];
+            for (s32 round = 0; round < 4000; ++round)
+            {
+                uint_t const n = make_text(text, sizeof(text), (u32)(round % 5) * 64);
+                u32 const    r = next_random();
+                if (n)
+                    text[r % n] = (char)(r >> 16);
+                uint_t const units = env_utf8_to_utf16_len(text, n);
+                if (ref_valid(text, n))
+                {
+                    CHECK_TRUE(units != env_utf_invalid);
+                    CHECK_EQUAL(units, env_utf8_to_utf16(text, n, wide));
+                    CHECK_TRUE(roundtrip(text, n));
+                }
+                else
+                {
+                    CHECK_EQUAL(env_utf_invalid, units);
+                    CHECK_EQUAL(env_utf_invalid, env_utf8_to_utf16(text, n, wide));
+                }
+            }
+        }
+
+        UNITTEST_TEST(invalid_utf16)
+        {
+            u16 const lone_high[] = {'a', 0xD800, 'b'};
+            u16 const lone_low[]  = {0xDC00};
+            u16 const at_end[]    = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 0xD83D};
+            u16 const pair[]      = {'a', 'b', 'c', 'd', 'e', 'f', 'g', 0xD83D, 0xDE00};
+            CHECK_EQUAL(env_utf_invalid, env_utf16_to_utf8_len(lone_high, 3));
+            CHECK_EQUAL(env_utf_invalid, env_utf16_to_utf8_len(lone_low, 1));
+            CHECK_EQUAL(env_utf_invalid, env_utf16_to_utf8_len(at_end, 9));
+            CHECK_EQUAL(11, (s32)env_utf16_to_utf8_len(pair, 9));
+        }
+
+        UNITTEST_TEST(random)
+        {
+            // every length and every density so that all block boundaries are crossed
+            char text[300];
+            for (u32 density = 0; density <= 256; density += 32)
+            {
+                for (uint_t len = 0; len < 300; len += 7)
+                {
+                    uint_t const n = make_text(text, len, density);
+                    CHECK_TRUE(roundtrip(text, n));
+                }
+            }
+        }
+    }
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+    UNITTEST_FIXTURE(bench)
+    {
+        static void run(char const* what, u32 density)
+        {
+            const uint_t size  = 64 * 1024;
+            const s32    loops = 64;
+
+            alloc_t* allocator = context_t::system_alloc();
+            char*    text      = (char*)allocator->allocate(size);
+            u16*     wide      = (u16*)allocator->allocate(size * sizeof(u16));
+            char*    back      = (char*)allocator->allocate(size);
+            uint_t   len       = make_text(text, size, density);
+
+            char label[64];
+            u64  t0 = bench_now_ns();
+            for (s32 i = 0; i < loops; ++i)
+                ref_utf8_to_utf16(text, len, wide);
+            u64 t1 = bench_now_ns();
+            snprintf(label, sizeof(label), "%s utf8->utf16 reference", what);
+            bench_report_rate(label, len * loops, t1 - t0);
+
+            uint_t units = 0;
+            t0           = bench_now_ns();
+            for (s32 i = 0; i < loops; ++i)
+            {
+                units = env_utf8_to_utf16_len(text, len);
+                env_utf8_to_utf16(text, len, wide);
+            }
+            t1 = bench_now_ns();
+            snprintf(label, sizeof(label), "%s utf8->utf16 len+convert", what);
+            bench_report_rate(label, len * loops, t1 - t0);
+
+            // a string that fits the output is converted and validated in one pass
+            t0 = bench_now_ns();
+            for (s32 i = 0; i < loops; ++i)
+                env_utf8_to_utf16(text, len, wide);
+            t1 = bench_now_ns();
+            snprintf(label, sizeof(label), "%s utf8->utf16 convert", what);
+            bench_report_rate(label, len * loops, t1 - t0);
+
+            t0 = bench_now_ns();
+            for (s32 i = 0; i < loops; ++i)
+            {
+                env_utf16_to_utf8_len(wide, units);
+                env_utf16_to_utf8(wide, units, back);
+            }
+            t1 = bench_now_ns();
+            snprintf(label, sizeof(label), "%s utf16->utf8 len+convert", what);
+            bench_report_rate(label, len * loops, t1 - t0);
+
+            CHECK_EQUAL(0, memcmp(text, back, len));
+
+            allocator->deallocate(back);
+            allocator->deallocate(wide);
+            allocator->deallocate(text);
+        }
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(throughput)
+        {
+            if (!bench_enabled("utf throughput"))
+                return;
+
+            run("ascii", 0);
+            run("mixed", 8);
+            run("dense", 128);
+        }
+    }
+
+#endif
+}
+UNITTEST_SUITE_END
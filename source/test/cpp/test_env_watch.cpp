@@ -0,0 +1,294 @@
+#include "cbase/c_allocator.h"
+#include "cbase/c_context.h"
+#include "cenv/c_env.h"
+#include "cenv/c_env_guard.h"
+#include "cenv/c_env_watch.h"
+#include "cunittest/cunittest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using namespace ncore;
+using namespace ncore::nenv;
+
+UNITTEST_SUITE_BEGIN(test_env_watch)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        // what the last callback saw
+        struct seen_t
+        {
+            s32  m_calls;
+            s32  m_count;
+            char m_name[64];
+            char m_old[64];
+            char m_new[64];
+            bool m_had_old;
+            bool m_has_new;
+        };
+
+        static void copy_view(char* dst, env_view_t const& view)
+        {
+            uint_t const len = view.m_str ? view.m_len : 0;
+            if (view.m_str)
+                memcpy(dst, view.m_str, len);
+            dst[len] = '\0';
+        }
+
+        static void on_change(void* user, env_change_t const* changes, uint_t count)
+        {
+            seen_t* seen = (seen_t*)user;
+            seen->m_calls++;
+            seen->m_count = (s32)count;
+            copy_view(seen->m_name, changes[count - 1].m_name);
+            copy_view(seen->m_old, changes[count - 1].m_old);
+            copy_view(seen->m_new, changes[count - 1].m_new);
+            seen->m_had_old = changes[count - 1].m_old.m_str != null;
+            seen->m_has_new = changes[count - 1].m_new.m_str != null;
+        }
+
+        static void on_change_unwatch(void* user, env_change_t const*, uint_t)
+        {
+            env_watch_t** watch = (env_watch_t**)user;
+            env_unwatch(*watch);
+            *watch = null;
+        }
+
+        // counts the allocations that go through the system allocator
+        class counting_alloc_t : public alloc_t
+        {
+        public:
+            alloc_t* m_allocator;
+            s32      m_allocations;
+
+            counting_alloc_t(alloc_t* allocator)
+                : m_allocator(allocator)
+                , m_allocations(0)
+            {
+            }
+
+            virtual void* v_allocate(u32 size, u32 alignment)
+            {
+                m_allocations++;
+                return m_allocator->allocate(size, alignment);
+            }
+            virtual u32  v_deallocate(void* mem) { return m_allocator->deallocate(mem); }
+            virtual void v_release() {}
+        };
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            env_set("CENV_WATCH_A", "a");
+            env_remove("CENV_WATCH_B");
+            env_remove("CENV_WATCHX");
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN()
+        {
+            env_remove("CENV_WATCH_A");
+            env_remove("CENV_WATCH_B");
+            env_remove("CENV_WATCHX");
+        }
+
+        UNITTEST_TEST(exact)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_A", false, env_watch_sync, on_change, &seen);
+            CHECK_NOT_NULL(watch);
+
+            env_set("CENV_WATCH_A", "b");
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(0, strcmp(seen.m_name, "CENV_WATCH_A"));
+            CHECK_EQUAL(0, strcmp(seen.m_old, "a"));
+            CHECK_EQUAL(0, strcmp(seen.m_new, "b"));
+
+            // another variable, also one that has the key as prefix
+            env_set("CENV_WATCH_B", "x");
+            env_set("CENV_WATCH_AB", "x");
+            CHECK_EQUAL(1, seen.m_calls);
+            env_remove("CENV_WATCH_AB");
+
+            env_remove("CENV_WATCH_A");
+            CHECK_EQUAL(2, seen.m_calls);
+            CHECK_TRUE(seen.m_had_old);
+            CHECK_FALSE(seen.m_has_new);
+
+            env_unwatch(watch);
+        }
+
+        UNITTEST_TEST(prefix)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_", true, env_watch_sync, on_change, &seen);
+
+            env_set("CENV_WATCH_B", "new");
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(0, strcmp(seen.m_name, "CENV_WATCH_B"));
+            CHECK_FALSE(seen.m_had_old);
+            CHECK_EQUAL(0, strcmp(seen.m_new, "new"));
+
+            env_set("CENV_WATCHX", "x");
+            CHECK_EQUAL(1, seen.m_calls);
+
+            env_unwatch(watch);
+        }
+
+        UNITTEST_TEST(batch)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_", true, env_watch_sync, on_change, &seen);
+
+            env_batch_begin();
+            env_set("CENV_WATCH_A", "1");
+            env_set("CENV_WATCH_A", "2");
+            env_batch_begin();
+            env_set("CENV_WATCH_A", "3");
+            env_batch_end();
+            CHECK_EQUAL(0, seen.m_calls);
+            env_set("CENV_WATCH_B", "b");
+            env_batch_end();
+
+            // one callback, the first old value and the last new value
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(2, seen.m_count);
+
+            env_unwatch(watch);
+            env_remove("CENV_WATCH_B");
+
+            seen  = seen_t();
+            watch = env_watch("CENV_WATCH_A", false, env_watch_sync, on_change, &seen);
+            env_batch_begin();
+            env_set("CENV_WATCH_A", "4");
+            env_set("CENV_WATCH_A", "3");
+            env_batch_end();
+            CHECK_EQUAL(0, seen.m_calls);
+
+            env_batch_begin();
+            env_set("CENV_WATCH_A", "4");
+            env_set("CENV_WATCH_A", "5");
+            env_batch_end();
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(0, strcmp(seen.m_old, "3"));
+            CHECK_EQUAL(0, strcmp(seen.m_new, "5"));
+
+            env_unwatch(watch);
+        }
+
+        UNITTEST_TEST(large_batch)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_", true, env_watch_sync, on_change, &seen);
+
+            // every variable changes twice, the pending changes grow and coalesce by name
+            char name[32];
+            env_batch_begin();
+            for (s32 round = 0; round < 2; ++round)
+            {
+                for (s32 i = 0; i < 300; ++i)
+                {
+                    snprintf(name, sizeof(name), "CENV_WATCH_N%d", i);
+                    env_set(name, round ? "2" : "1");
+                }
+            }
+            env_batch_end();
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(300, seen.m_count);
+            CHECK_EQUAL(0, strcmp(seen.m_name, "CENV_WATCH_N299"));
+            CHECK_FALSE(seen.m_had_old);
+            CHECK_EQUAL(0, strcmp(seen.m_new, "2"));
+
+            env_batch_begin();
+            for (s32 i = 0; i < 300; ++i)
+            {
+                snprintf(name, sizeof(name), "CENV_WATCH_N%d", i);
+                env_remove(name);
+            }
+            env_batch_end();
+            CHECK_EQUAL(2, seen.m_calls);
+            CHECK_EQUAL(300, seen.m_count);
+            CHECK_EQUAL(0, strcmp(seen.m_old, "2"));
+
+            env_unwatch(watch);
+        }
+
+        UNITTEST_TEST(deferred)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_A", false, env_watch_deferred, on_change, &seen);
+
+            env_set("CENV_WATCH_A", "1");
+            env_set("CENV_WATCH_A", "2");
+            CHECK_EQUAL(0, seen.m_calls);
+            CHECK_EQUAL(1, (s32)env_watch_pump());
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(0, strcmp(seen.m_old, "a"));
+            CHECK_EQUAL(0, strcmp(seen.m_new, "2"));
+            CHECK_EQUAL(0, (s32)env_watch_pump());
+
+            // pending changes are dropped
+            env_set("CENV_WATCH_A", "3");
+            env_unwatch(watch);
+            CHECK_EQUAL(0, (s32)env_watch_pump());
+            CHECK_EQUAL(1, seen.m_calls);
+        }
+
+        UNITTEST_TEST(unwatch)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_A", false, env_watch_sync, on_change, &seen);
+            env_unwatch(watch);
+            env_set("CENV_WATCH_A", "1");
+            CHECK_EQUAL(0, seen.m_calls);
+
+            // from the callback
+            env_watch_t* self = env_watch("CENV_WATCH_A", false, env_watch_sync, on_change_unwatch, &self);
+            env_set("CENV_WATCH_A", "2");
+            CHECK_NULL(self);
+            env_set("CENV_WATCH_A", "3");
+        }
+
+        UNITTEST_TEST(no_match_no_alloc)
+        {
+            seen_t       seen  = {};
+            env_watch_t* watch = env_watch("CENV_WATCH_A", false, env_watch_sync, on_change, &seen);
+
+            // a change nobody watches is filtered out before anything is copied
+            alloc_t*         system = context_t::system_alloc();
+            counting_alloc_t counting(system);
+            context_t::set_system_alloc(&counting);
+            env_set("CENV_WATCH_B", "x");
+            env_remove("CENV_WATCH_B");
+            context_t::set_system_alloc(system);
+
+            CHECK_EQUAL(0, counting.m_allocations);
+            CHECK_EQUAL(0, seen.m_calls);
+
+            // and a watched one does allocate, so the counter is in the path
+            context_t::set_system_alloc(&counting);
+            env_set("CENV_WATCH_A", "y");
+            context_t::set_system_alloc(system);
+            CHECK_TRUE(counting.m_allocations > 0);
+            CHECK_EQUAL(1, seen.m_calls);
+
+            env_unwatch(watch);
+        }
+
+        UNITTEST_TEST(guard_rollback)
+        {
+            seen_t       seen  = {};
+            env_guard_t* guard = env_guard_begin();
+            env_set("CENV_WATCH_A", "1");
+            env_set("CENV_WATCH_B", "2");
+
+            env_watch_t* watch = env_watch("CENV_WATCH_", true, env_watch_sync, on_change, &seen);
+            env_guard_end(guard);
+
+            // one batch for the whole rollback
+            CHECK_EQUAL(1, seen.m_calls);
+            CHECK_EQUAL(2, seen.m_count);
+
+            env_unwatch(watch);
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -9,6 +9,15 @@
 
 UNITTEST_SUITE_LIST(cUnitTest);
 UNITTEST_SUITE_DECLARE(cUnitTest, test_registry);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_snapshot);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_shm);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_tree);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_utf);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_guard);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_export);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_watch);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_fingerprint);
+UNITTEST_SUITE_DECLARE(cUnitTest, test_env_contention);
 
 namespace ncore
 {
@@ -0,0 +1,84 @@
+#ifndef __CENV_TEST_BENCH_H__
+#define __CENV_TEST_BENCH_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cbase/c_console.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+#    include <time.h>
+#endif
+
+namespace ncore
+{
+    namespace nenv
+    {
+#if defined(TARGET_LINUX) || defined(TARGET_MAC)
+
+        // the scaffolding of the bench fixtures, a monotonic clock and one line per result
+        //
+        // the benches only run when CENV_BENCH is set to something else than 0, they take long
+        // and their numbers mean nothing in a sanitizer or debug build
+
+        // returns true if the benches are enabled, otherwise reports the skipped bench
+        //
+        // @param what          the name of the bench
+        //
+        // @return              true if the bench should run
+        inline bool bench_enabled(char const* what)
+        {
+            char const* value = getenv("CENV_BENCH");
+            if (value && value[0] && !(value[0] == '0' && value[1] == '\0'))
+                return true;
+
+            char line[128];
+            snprintf(line, sizeof(line), "    %s skipped, set CENV_BENCH=1 to run it", what);
+            console->writeLine(line);
+            return false;
+        }
+
+        // the duration of a timed bench in ns, CENV_BENCH_MS overrides the default
+        //
+        // @param default_ms    the duration in ms when CENV_BENCH_MS is not set
+        //
+        // @return              the duration in ns
+        inline u64 bench_duration_ns(u64 default_ms)
+        {
+            char const* value = getenv("CENV_BENCH_MS");
+            u64 const   ms    = value ? (u64)strtoull(value, null, 10) : 0;
+            return (ms ? ms : default_ms) * 1000000ull;
+        }
+
+        inline u64 bench_now_ns()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+        }
+
+        // report a throughput in MB/s
+        inline void bench_report_rate(char const* what, u64 bytes, u64 ns)
+        {
+            char line[128];
+            snprintf(line, sizeof(line), "    %-40s %8.1f MB/s", what, ns ? (double)bytes * 1000.0 / (double)ns : 0.0);
+            console->writeLine(line);
+        }
+
+        // report the time of one operation in ns
+        inline void bench_report_op(char const* what, u64 ops, u64 ns)
+        {
+            char line[128];
+            snprintf(line, sizeof(line), "    %-40s %8.1f ns/op", what, ops ? (double)ns / (double)ops : 0.0);
+            console->writeLine(line);
+        }
+
+#endif
+    } // namespace nenv
+} // namespace ncore
+
+#endif //< __CENV_TEST_BENCH_H__